@@ -0,0 +1,212 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include "logic.h"
+
+
+struct batch {
+    unsigned int n;
+    unsigned int run, width, height;
+    unsigned int words;
+    uint64_t* cells;
+    cell* to_move;
+    unsigned int* filled;
+    outcome* out;
+    unsigned int live;
+};
+
+typedef struct batch batch;
+
+
+batch* batch_new(unsigned int n, unsigned int run, unsigned int width,
+                 unsigned int height) {
+    if (n == 0 || width == 0 || height == 0) {
+        fprintf(stderr, "Must be 2 dimensional\n");
+        exit(1);
+    }
+
+    batch* mb = (batch*)malloc(sizeof(batch));
+    if (mb == NULL) {
+        fprintf(stderr, "Batch allocation failed\n");
+        exit(1);
+    }
+    mb->n = n;
+    mb->run = run;
+    mb->width = width;
+    mb->height = height;
+    mb->words = board_words_len(width, height);
+    mb->live = n;
+
+    size_t nwords = (size_t)mb->words * n;
+    STATS_ADD(alloc_bytes, nwords * sizeof(uint64_t) +
+              n * (sizeof(cell) + sizeof(unsigned int) + sizeof(outcome)));
+    mb->cells = (uint64_t*)malloc(nwords * sizeof(uint64_t));
+    mb->to_move = (cell*)malloc(n * sizeof(cell));
+    mb->filled = (unsigned int*)malloc(n * sizeof(unsigned int));
+    mb->out = (outcome*)malloc(n * sizeof(outcome));
+    if (mb->cells == NULL || mb->to_move == NULL || mb->filled == NULL ||
+        mb->out == NULL) {
+        fprintf(stderr, "Batch allocation failed\n");
+        exit(1);
+    }
+    for (size_t i = 0; i < nwords; i++) {
+        mb->cells[i] = 0;
+    }
+    for (unsigned int g = 0; g < n; g++) {
+        mb->to_move[g] = BLACK;
+        mb->filled[g] = 0;
+        mb->out[g] = IN_PROGRESS;
+    }
+    return mb;
+}
+
+
+void batch_free(batch* mb) {
+    free(mb->cells);
+    free(mb->to_move);
+    free(mb->filled);
+    free(mb->out);
+    free(mb);
+}
+
+
+/* Unchecked SoA cell read: 2-bit cell idx of game g, the word picked
+out of the interleaved array*/
+static cell soa_get(const batch* mb, unsigned int g, unsigned int idx) {
+    unsigned int i = 2 * idx;
+    return (cell)((mb->cells[(i / 64) * mb->n + g] >> (i % 64)) & 0x3);
+}
+
+static void soa_set(batch* mb, unsigned int g, unsigned int idx, cell c) {
+    unsigned int i = 2 * idx;
+    uint64_t* w = &mb->cells[(i / 64) * mb->n + g];
+    *w &= ~(0x3ULL << (i % 64));
+    *w |= ((uint64_t)c << (i % 64));
+}
+
+
+cell batch_get(const batch* mb, unsigned int g, pos p) {
+    if (g >= mb->n || mb->height < p.r || mb->width < p.c) {
+        printf("Out of bounds error\n");
+        exit(1);
+    }
+    return soa_get(mb, g, p.r * mb->width + p.c);
+}
+
+
+/* Counts the same-color run through a just-placed cell of game g along
+(dr, dc), looking both ways — the batch counterpart of the per-game
+incremental check in logic.c*/
+static unsigned int batch_run_through(const batch* mb, unsigned int g,
+                                      pos p, cell c, int dr, int dc) {
+    unsigned int length = 1;
+    int h = (int)mb->height;
+    int w = (int)mb->width;
+
+    int r = (int)p.r + dr;
+    int col = (int)p.c + dc;
+    while (0 <= r && r < h && 0 <= col && col < w &&
+           soa_get(mb, g, r * w + col) == c) {
+        length++;
+        r += dr;
+        col += dc;
+    }
+
+    r = (int)p.r - dr;
+    col = (int)p.c - dc;
+    while (0 <= r && r < h && 0 <= col && col < w &&
+           soa_get(mb, g, r * w + col) == c) {
+        length++;
+        r -= dr;
+        col -= dc;
+    }
+    return length;
+}
+
+
+unsigned int batch_place(batch* mb, const pos* moves) {
+    unsigned int accepted = 0;
+
+    for (unsigned int g = 0; g < mb->n; g++) {
+        if (mb->out[g] != IN_PROGRESS) {
+            continue;
+        }
+        pos p = moves[g];
+        if (mb->height <= p.r || mb->width <= p.c) {
+            continue;
+        }
+        unsigned int idx = p.r * mb->width + p.c;
+        if (soa_get(mb, g, idx) != EMPTY) {
+            continue;
+        }
+
+        cell c = mb->to_move[g];
+        soa_set(mb, g, idx, c);
+        mb->to_move[g] = (c == BLACK) ? WHITE : BLACK;
+        mb->filled[g]++;
+        accepted++;
+
+        if (batch_run_through(mb, g, p, c, 0, 1) >= mb->run ||
+            batch_run_through(mb, g, p, c, 1, 0) >= mb->run ||
+            batch_run_through(mb, g, p, c, 1, 1) >= mb->run ||
+            batch_run_through(mb, g, p, c, 1, -1) >= mb->run) {
+            mb->out[g] = (c == BLACK) ? BLACK_WIN : WHITE_WIN;
+            mb->live--;
+        } else if (mb->filled[g] == mb->width * mb->height) {
+            mb->out[g] = DRAW;
+            mb->live--;
+        }
+    }
+    return accepted;
+}
+
+
+/* Compacts the even bits of x (bits 0,2,4,...) into the low 32 bits;
+the same halving ladder board.c uses to turn 2-bit cell lanes into a
+one-bit-per-cell mask*/
+static uint64_t even_bits(uint64_t x) {
+    x &= 0x5555555555555555ULL;
+    x = (x | (x >> 1)) & 0x3333333333333333ULL;
+    x = (x | (x >> 2)) & 0x0F0F0F0F0F0F0F0FULL;
+    x = (x | (x >> 4)) & 0x00FF00FF00FF00FFULL;
+    x = (x | (x >> 8)) & 0x0000FFFF0000FFFFULL;
+    x = (x | (x >> 16)) & 0x00000000FFFFFFFFULL;
+    return x;
+}
+
+
+void batch_empty_mask(const batch* mb, uint64_t* out) {
+    unsigned int cells = mb->width * mb->height;
+    unsigned int mwords = (cells + 63) / 64;
+    unsigned int n = mb->n;
+
+    /* word index outer, game index inner: for each o the n source
+    words and n destination words are contiguous runs, so the whole
+    batch is two sequential streams however many games there are */
+    for (unsigned int o = 0; o < mwords; o++) {
+        const uint64_t* lo_src = &mb->cells[(2 * o) * n];
+        const uint64_t* hi_src =
+            (2 * o + 1 < mb->words) ? &mb->cells[(2 * o + 1) * n] : NULL;
+        uint64_t* dst = &out[o * n];
+
+        for (unsigned int g = 0; g < n; g++) {
+            uint64_t x0 = lo_src[g];
+            uint64_t m = even_bits(~(x0 | (x0 >> 1)) & 0x5555555555555555ULL);
+            if (hi_src != NULL) {
+                uint64_t x1 = hi_src[g];
+                m |= even_bits(~(x1 | (x1 >> 1)) & 0x5555555555555555ULL)
+                     << 32;
+            }
+            dst[g] = m;
+        }
+    }
+
+    /* clear the padding bits past the last cell so every set bit is a
+    real legal move */
+    if (cells % 64 != 0) {
+        uint64_t tail = (1ULL << (cells % 64)) - 1;
+        uint64_t* dst = &out[(mwords - 1) * n];
+        for (unsigned int g = 0; g < n; g++) {
+            dst[g] &= tail;
+        }
+    }
+}
@@ -0,0 +1,60 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "logic.h"
+
+
+/* N simultaneous games with identical dimensions, stored as a
+structure of arrays over the BITS layout: word i of every board is
+contiguous (cells[i * n + g] is word i of game g), so kernels that
+stream the boards process the same word index across all N games per
+inner-loop iteration and the whole batch moves through memory once,
+sequentially. Placement games only — the batch engine has no rotation
+or uplift, which is what lets every board keep the same shape and the
+outcome stay incremental*/
+struct batch {
+    unsigned int n;
+    unsigned int run, width, height;
+    /* 64-bit words per board (the bits_len of one board)*/
+    unsigned int words;
+    uint64_t* cells;
+    /* per-game state arrays, indexed by game number*/
+    cell* to_move;
+    unsigned int* filled;
+    outcome* out;
+    /* games whose outcome is still IN_PROGRESS*/
+    unsigned int live;
+};
+
+typedef struct batch batch;
+
+/* Allocates a batch of n empty games, all black to move; exits on
+allocation failure like the rest of the engine*/
+batch* batch_new(unsigned int n, unsigned int run, unsigned int width,
+                 unsigned int height);
+
+/* Frees the batch and all its arrays*/
+void batch_free(batch* mb);
+
+/* The cell at p in game g; bounds-checked like board_get*/
+cell batch_get(const batch* mb, unsigned int g, pos p);
+
+/* Applies one placement per game — moves[g] into game g — for every
+game still in progress, each as the game's side to move. A move into an
+occupied cell is skipped and the game left untouched. Outcomes update
+incrementally through the placed cell (the same four-direction run
+walk place_piece uses), so no game is ever full-scanned. Returns how
+many games accepted their move*/
+unsigned int batch_place(batch* mb, const pos* moves);
+
+/* Move generation for the whole batch: fills out with every game's
+empty-cell mask, laid out SoA like the boards — mask word o of game g
+at out[o * n + g], board_mask_words(width, height) words per game. One
+word test derives 32 cells, and for each word index the n source and n
+destination words are contiguous, so the loop is a single sequential
+sweep the compiler can vectorize across games*/
+void batch_empty_mask(const batch* mb, uint64_t* out);
+
+#endif /* BATCH_H */
@@ -0,0 +1,171 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "logic.h"
+#include "stats.h"
+
+/* Benchmark driver for the engine hot paths: times place_piece, rotate
+(both representations, board sizes 8x8 up to 512x512), game_outcome,
+and uplift over fixed seeded move sequences, printing one CSV line per
+measurement so results can be tracked across releases. Built by the
+`bench` Makefile target at -O2*/
+
+static unsigned int bench_seed = 0x12345678;
+
+/* Deterministic PRNG so every run times the same move sequence*/
+static unsigned int prng(void) {
+    bench_seed = bench_seed * 1664525u + 1013904223u;
+    return bench_seed >> 8;
+}
+
+/* Current monotonic time in nanoseconds*/
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/* One CSV result line: benchmark name, representation, board size,
+operation count, ns per op, ops per second*/
+static void report(const char* name, enum type t, unsigned int size,
+                   unsigned long ops, double ns) {
+    printf("%s,%s,%u,%lu,%.1f,%.0f\n", name, t == MATRIX ? "matrix" : "bits",
+           size, ops, ns / (double)ops, (double)ops * 1e9 / ns);
+}
+
+/* Fills the board by placing every cell in a seeded scrambled order;
+run = size so no outcome ends the game early*/
+static void bench_place(enum type t, unsigned int size, unsigned int reps) {
+    unsigned long ops = 0;
+    double total = 0;
+
+    for (unsigned int rep = 0; rep < reps; rep++) {
+        game* g = new_game(size + 1, size, size, t);
+        double t0 = now_ns();
+        for (unsigned int i = 0; i < size * size; i++) {
+            /* seeded probe: try random cells, fall back to scanning */
+            pos p = make_pos(prng() % size, prng() % size);
+            while (!place_piece(g, p)) {
+                p.c = (p.c + 1) % size;
+                if (p.c == 0) {
+                    p.r = (p.r + 1) % size;
+                }
+            }
+            ops++;
+        }
+        total += now_ns() - t0;
+        game_free(g);
+    }
+    report("place_piece", t, size, ops, total);
+}
+
+/* Repeated same-direction rotations (always legal) on a board seeded
+with pieces; steady-state, so the double-buffer path is what is timed*/
+static void bench_rotate(enum type t, unsigned int size, unsigned int reps) {
+    game* g = new_game(size + 1, size, size, t);
+    for (unsigned int i = 0; i < size; i++) {
+        place_piece(g, make_pos(prng() % size, prng() % size));
+    }
+
+    double t0 = now_ns();
+    for (unsigned int rep = 0; rep < reps; rep++) {
+        rotate(g, true);
+    }
+    double total = now_ns() - t0;
+    game_free(g);
+    report("rotate", t, size, reps, total);
+}
+
+/* A splitmix64-style mix, for when the LCG is not enough: its low bits
+have short periods, so a cell sequence drawn from them cycles after a
+couple of thousand draws*/
+static uint64_t mix64(uint64_t z) {
+    z += 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/* Full outcome scans on a seeded half-filled board. Invalidating the
+cached outcome is not enough on its own: an unchanged position keeps
+its Zobrist key and the transposition table in game_outcome answers
+from a probe, so the loop toggles one cell first — the position (and
+its key) changes every iteration and the scan has to run. The toggled
+cell comes from mix64 of the iteration counter, because a periodic
+toggle sequence walks back through earlier positions and the table
+starts answering again. The toggle is a single board_set against a
+whole-board scan, so its share of the measured time is noise*/
+static void bench_outcome(enum type t, unsigned int size, unsigned int reps) {
+    game* g = new_game(size + 1, size, size, t);
+    for (unsigned int i = 0; i < size * size / 2; i++) {
+        place_piece(g, make_pos(prng() % size, prng() % size));
+    }
+
+    double t0 = now_ns();
+    for (unsigned int rep = 0; rep < reps; rep++) {
+        unsigned int idx = (unsigned int)(mix64(rep) % (size * size));
+        pos p = make_pos(idx / size, idx % size);
+        board_set(g->b, p, board_get(g->b, p) == EMPTY ? BLACK : EMPTY);
+        g->outcome_valid = false;
+        game_outcome(g);
+    }
+    double total = now_ns() - t0;
+    game_free(g);
+    report("game_outcome", t, size, reps, total);
+}
+
+/* Bottom-row placements followed by uplifts across every column; only
+the uplift calls are timed, and undo_move rewinds the board so each
+repetition raises pieces over the same distance*/
+static void bench_uplift(enum type t, unsigned int size, unsigned int reps) {
+    game* g = new_game(size + 1, size, size, t);
+    unsigned long ops = 0;
+    double total = 0;
+
+    for (unsigned int rep = 0; rep < reps; rep++) {
+        for (unsigned int c = 0; c < size; c++) {
+            place_piece(g, make_pos(size - 1, c));
+        }
+        double t0 = now_ns();
+        for (unsigned int c = 0; c < size; c++) {
+            uplift(g, (c % 2 == 0) ? BLACK : WHITE);
+            ops++;
+        }
+        total += now_ns() - t0;
+        for (unsigned int c = 0; c < 2 * size; c++) {
+            undo_move(g);
+        }
+    }
+    game_free(g);
+    report("uplift", t, size, ops, total);
+}
+
+int main(int argc, char* argv[]) {
+    /* optional scale factor so CI can run a quick pass */
+    unsigned int scale = 1;
+    if (argc > 1) {
+        scale = atoi(argv[1]);
+        if (scale == 0) {
+            scale = 1;
+        }
+    }
+
+    unsigned int sizes[] = {8, 16, 32, 64, 128, 256, 512};
+    unsigned int nsizes = sizeof(sizes) / sizeof(sizes[0]);
+    enum type types[] = {MATRIX, BITS};
+
+    printf("benchmark,rep,size,ops,ns_per_op,ops_per_sec\n");
+    for (unsigned int ti = 0; ti < 2; ti++) {
+        for (unsigned int si = 0; si < nsizes; si++) {
+            unsigned int size = sizes[si];
+            unsigned int cellreps = 1 + 262144 / (size * size) * scale;
+            bench_place(types[ti], size, cellreps);
+            bench_rotate(types[ti], size, 4 * cellreps);
+            bench_outcome(types[ti], size, cellreps);
+            bench_uplift(types[ti], size, cellreps);
+        }
+    }
+    stats_dump();
+    return 0;
+}
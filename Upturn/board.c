@@ -1,6 +1,11 @@
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include "pos.h"
+#include "stats.h"
+#include <sys/mman.h>
 
 enum cell {
     EMPTY,
@@ -12,8 +17,8 @@ typedef enum cell cell;
 
 
 union board_rep {
-    enum cell** matrix;
-    unsigned int* bits;
+    enum cell* matrix;
+    uint64_t* bits;
 };
 
 typedef union board_rep board_rep;
@@ -26,11 +31,47 @@ enum type {
 struct board {
     unsigned int width, height;
     enum type type;
+    uint64_t hash;
     board_rep u;
+    unsigned int* refcount;
+    void* mapping;
+    size_t mapping_len;
+    uint64_t* dirty;
+    bool dirty_all;
 };
 
 typedef struct board board;
 
+struct board_delta {
+    pos p;
+    cell c;
+};
+
+typedef struct board_delta board_delta;
+
+
+/* The Zobrist key for cell index idx holding color c: a splitmix64
+mix of the index and color, computed on the fly so no per-board key
+table is needed; EMPTY contributes nothing, so an empty board hashes
+to zero and board_set can XOR keys in and out incrementally*/
+static uint64_t cell_key(unsigned int idx, cell c) {
+    if (c == EMPTY) {
+        return 0;
+    }
+    uint64_t z = ((uint64_t)idx << 2 | c) + 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+
+/* Number of 64-bit words backing a BITS board of the given dimensions;
+rounds up, so every cell fits whatever the dimensions (the old 32-bit
+formula under-allocated for various non-multiple sizes)*/
+static unsigned int bits_len(unsigned int width, unsigned int height) {
+    return (2 * width * height + 63) / 64;
+}
+
 
 board* board_new(unsigned int width, unsigned int height, enum type type) {
     if (width == 0 || height == 0) {
@@ -42,43 +83,159 @@ board* board_new(unsigned int width, unsigned int height, enum type type) {
     new_board->width = width;
     new_board->height = height;
     new_board->type = type;
+    new_board->hash = 0;
+    new_board->refcount = NULL;
+    new_board->mapping = NULL;
+    new_board->mapping_len = 0;
+    new_board->dirty = NULL;
+    new_board->dirty_all = false;
+    STATS_ADD(alloc_bytes, sizeof(board));
     unsigned int bit_len = 0;
     if (type != MATRIX) {
-        bit_len = (2 * width * height) / 32;
-        if ((width / height) % 32 == 0 || (2 * width * height) < 32) {
-            bit_len++;
-        }
-        new_board->u.bits = (unsigned int*)malloc(bit_len * sizeof(unsigned int));
+        bit_len = bits_len(width, height);
+        STATS_ADD(alloc_bytes, bit_len * sizeof(uint64_t));
+        new_board->u.bits = (uint64_t*)malloc(bit_len * sizeof(uint64_t));
         for (unsigned int i=0; i < bit_len; i++) {
             new_board->u.bits[i] = 0;
         }
         return new_board;
     }
     
-    new_board->u.matrix = (cell**)malloc(height * sizeof(cell*));
-    for (unsigned int i=0; i < height; i++) {
-        new_board->u.matrix[i] = (cell*)malloc(width * sizeof(cell));
-        for (unsigned int j=0; j < width; j++) {
-            new_board->u.matrix[i][j] = EMPTY;
-        }
+    STATS_ADD(alloc_bytes, width * height * sizeof(cell));
+    new_board->u.matrix = (cell*)malloc(width * height * sizeof(cell));
+    for (unsigned int i=0; i < width * height; i++) {
+        new_board->u.matrix[i] = EMPTY;
     }
     return new_board;
 
 }
 
 
+/* Bytes of cell storage behind either representation*/
+static size_t cells_bytes(board* b) {
+    if (b->type == MATRIX) {
+        return (size_t)b->width * b->height * sizeof(cell);
+    }
+    return (size_t)bits_len(b->width, b->height) * sizeof(uint64_t);
+}
+
+/* Gives b private cell storage if it is currently sharing with
+copy-on-write clones: copies the cells when another board still holds
+them, or just adopts them outright as the last sharer*/
+static void cow_materialize(board* b) {
+    if (b->refcount == NULL) {
+        return;
+    }
+    if (*b->refcount == 1) {
+        free(b->refcount);
+        b->refcount = NULL;
+        return;
+    }
+    size_t bytes = cells_bytes(b);
+    void* copy = malloc(bytes);
+    if (copy == NULL) {
+        fprintf(stderr, "Snapshot copy failed\n");
+        exit(1);
+    }
+    memcpy(copy, b->u.matrix, bytes);
+    (*b->refcount)--;
+    b->u.matrix = (cell*)copy;
+    b->refcount = NULL;
+    b->mapping = NULL;
+    b->mapping_len = 0;
+}
+
+void board_clear(board* b) {
+    if (b->refcount != NULL && *b->refcount > 1) {
+        /* about to overwrite everything anyway, so detach with fresh
+        storage rather than copying the cells first */
+        (*b->refcount)--;
+        b->refcount = NULL;
+        b->mapping = NULL;
+        b->mapping_len = 0;
+        b->u.matrix = (cell*)malloc(cells_bytes(b));
+        if (b->u.matrix == NULL) {
+            fprintf(stderr, "Snapshot copy failed\n");
+            exit(1);
+        }
+    } else if (b->refcount != NULL) {
+        free(b->refcount);
+        b->refcount = NULL;
+    }
+    if (b->type == MATRIX) {
+        memset(b->u.matrix, 0, b->width * b->height * sizeof(cell));
+    } else {
+        memset(b->u.bits, 0,
+               bits_len(b->width, b->height) * sizeof(uint64_t));
+    }
+    b->hash = 0;
+    if (b->dirty != NULL) {
+        b->dirty_all = true;
+    }
+}
+
+
 void board_free(board* b) {
-    if (b->type != MATRIX) {
+    free(b->dirty);
+    if (b->refcount != NULL) {
+        (*b->refcount)--;
+        if (*b->refcount > 0) {
+            free(b);
+            return;
+        }
+        free(b->refcount);
+    }
+    if (b->mapping != NULL) {
+        munmap(b->mapping, b->mapping_len);
+    } else if (b->type != MATRIX) {
         free(b->u.bits);
     } else {
-        for (unsigned int i=0; i < b->height; i++) {
-            free(b->u.matrix[i]);
-        }
         free(b->u.matrix);
     }
     free(b);
 }
 
+board* board_clone(board* b) {
+    board* copy = (board*)malloc(sizeof(board));
+    if (copy == NULL) {
+        return NULL;
+    }
+    *copy = *b;
+    copy->refcount = NULL;
+    copy->mapping = NULL;
+    copy->mapping_len = 0;
+    copy->dirty = NULL;
+    copy->dirty_all = false;
+    size_t bytes = cells_bytes(b);
+    copy->u.matrix = (cell*)malloc(bytes);
+    if (copy->u.matrix == NULL) {
+        free(copy);
+        return NULL;
+    }
+    memcpy(copy->u.matrix, b->u.matrix, bytes);
+    return copy;
+}
+
+board* board_clone_cow(board* b) {
+    board* copy = (board*)malloc(sizeof(board));
+    if (copy == NULL) {
+        return NULL;
+    }
+    if (b->refcount == NULL) {
+        b->refcount = (unsigned int*)malloc(sizeof(unsigned int));
+        if (b->refcount == NULL) {
+            free(copy);
+            return NULL;
+        }
+        *b->refcount = 1;
+    }
+    (*b->refcount)++;
+    *copy = *b;
+    copy->dirty = NULL;
+    copy->dirty_all = false;
+    return copy;
+}
+
 
 /* Given an integer, num, converts num to
 an uppercase or lowercase letter, or a ? depending on how high
@@ -100,71 +257,434 @@ char large_char(unsigned int num) {
 }
 
 cell board_get(board* b, pos p) {
+    STATS_ADD(board_gets, 1);
     if (b->height < p.r || b->width < p.c) {
         printf("Out of bounds error\n");
         exit(1);
     }
     if (b->type == MATRIX) {
-        return b->u.matrix[p.r][p.c];
+        return b->u.matrix[p.r * b->width + p.c];
     }
     unsigned int i = (2 * (p.r * b->width + p.c));
-    unsigned int loc = i / 32;
-    unsigned int position = i % 32;
+    unsigned int loc = i / 64;
+    unsigned int position = i % 64;
     return ((b->u.bits[loc] >> position) & 0x3);
     
 }
 
+/* The grid label for row/column number num: the digit itself below 10,
+letters (and eventually ?) above via large_char*/
+static char coord_char(unsigned int num) {
+    if (num < 10) {
+        return '0' + num;
+    }
+    return large_char(num);
+}
+
 void board_show(board* b) {
+    /* the frame is formatted into one buffer, sized from the board
+    dimensions and reused across calls, and written out with a single
+    fwrite instead of a printf per cell */
+    static char* frame = NULL;
+    static size_t frame_cap = 0;
+
     unsigned int w = b->width;
     unsigned int h = b->height;
-    char piece = '.';
-    
-    for (unsigned int i=0; i < w; i++) {
-        if (i == 0) {
-            printf("  ");
+    size_t need = ((size_t)h + 1) * (2 * (size_t)w + 4);
+    if (need > frame_cap) {
+        char* grown = realloc(frame, need);
+        if (grown == NULL) {
+            return;
         }
-        if (i < 10) {
-            printf("%d ", i);
+        frame = grown;
+        frame_cap = need;
+    }
+
+    char* out = frame;
+    *out++ = ' ';
+    *out++ = ' ';
+    for (unsigned int i = 0; i < w; i++) {
+        *out++ = coord_char(i);
+        *out++ = ' ';
+    }
+    *out++ = ' ';
+    *out++ = '\n';
+
+    for (unsigned int j = 0; j < h; j++) {
+        *out++ = coord_char(j);
+        *out++ = ' ';
+        if (b->type == MATRIX) {
+            cell* row = b->u.matrix + j * w;
+            for (unsigned int z = 0; z < w; z++) {
+                *out++ = (row[z] == BLACK) ? '*' : (row[z] == WHITE) ? 'o' : '.';
+                *out++ = ' ';
+            }
         } else {
-            printf("%c ", large_char(i));
+            unsigned int bit = 2 * j * w;
+            for (unsigned int z = 0; z < w; z++) {
+                cell v = (b->u.bits[bit / 64] >> (bit % 64)) & 0x3;
+                *out++ = (v == BLACK) ? '*' : (v == WHITE) ? 'o' : '.';
+                bit += 2;
+                *out++ = ' ';
+            }
         }
+        *out++ = '\n';
     }
-    printf(" ");
-    printf("\n");
-    for (unsigned int j=0; j < h; j++) {
-        if (j < 10) {
-            printf("%d ", j);
+
+    fwrite(frame, 1, out - frame, stdout);
+}
+
+
+void board_rotate_bits(board* src, board* dst, bool clockwise,
+                       unsigned int row_start, unsigned int row_end) {
+    unsigned int sw = src->width;
+    unsigned int dw = dst->width;
+    uint64_t* from = src->u.bits;
+    uint64_t* to = dst->u.bits;
+
+    for (unsigned int i = row_start; i < row_end; i++) {
+        /* source of destination cell (i, j): walking j walks a source
+        column, so the source bit index moves by a whole row per step */
+        unsigned int si;
+        int step;
+        if (clockwise) {
+            si = 2 * ((dw - 1) * sw + i);
+            step = -2 * (int)sw;
         } else {
-            printf("%c ", large_char(j));
+            si = 2 * (sw - 1 - i);
+            step = 2 * (int)sw;
         }
-        for (unsigned int z=0; z < w; z++) {
-            if (board_get(b, make_pos(j, z)) == BLACK) {
-                piece = '*';
-            } else if (board_get(b, make_pos(j, z)) == WHITE) {
-                piece = 'o';
-            } else {
-                piece = '.';
+
+        if (dw % 32 == 0) {
+            /* rows own whole words: pack 32 cells, then one store */
+            unsigned int loc = (2 * i * dw) / 64;
+            for (unsigned int j = 0; j < dw; j += 32) {
+                uint64_t word = 0;
+                for (unsigned int k = 0; k < 32; k++) {
+                    uint64_t c = (from[si / 64] >> (si % 64)) & 0x3;
+                    word |= c << (2 * k);
+                    si += step;
+                }
+                to[loc++] = word;
+            }
+        } else {
+            /* odd widths: rows share boundary words, so deposit cells
+            one at a time the way board_set would, minus the overhead */
+            unsigned int di = 2 * i * dw;
+            for (unsigned int j = 0; j < dw; j++) {
+                uint64_t c = (from[si / 64] >> (si % 64)) & 0x3;
+                to[di / 64] &= ~(0x3ULL << (di % 64));
+                to[di / 64] |= c << (di % 64);
+                si += step;
+                di += 2;
+            }
+        }
+    }
+}
+
+
+/* Packs the even-numbered bits of x (bits 0, 2, 4, ...) into the low
+32 bits; the standard bit-compaction ladder*/
+static uint64_t even_bits(uint64_t x) {
+    x &= 0x5555555555555555ULL;
+    x = (x | (x >> 1)) & 0x3333333333333333ULL;
+    x = (x | (x >> 2)) & 0x0F0F0F0F0F0F0F0FULL;
+    x = (x | (x >> 4)) & 0x00FF00FF00FF00FFULL;
+    x = (x | (x >> 8)) & 0x0000FFFF0000FFFFULL;
+    x = (x | (x >> 16)) & 0x00000000FFFFFFFFULL;
+    return x;
+}
+
+/* Fetches nbits packed bits starting at bit index bit, which need not
+be word aligned; nbits must be at most 64*/
+static uint64_t fetch_bits(const uint64_t* words, unsigned int bit,
+                           unsigned int nbits) {
+    unsigned int loc = bit / 64;
+    unsigned int off = bit % 64;
+    uint64_t x = words[loc] >> off;
+    if (off != 0 && off + nbits > 64) {
+        x |= words[loc + 1] << (64 - off);
+    }
+    return x;
+}
+
+/* Given a 32-lane mask m of cells holding one color (n lanes valid),
+decides whether a run of `run` consecutive set lanes exists, counting
+runs that continue from the previous chunk via *carry (the length of
+the run touching the boundary); updates *carry for the next chunk*/
+static bool mask_run_hit(uint64_t m, unsigned int n, unsigned int* carry,
+                         unsigned int run) {
+    uint64_t full = (n == 64) ? ~0ULL : ((1ULL << n) - 1);
+    m &= full;
+
+    if (m == full) {
+        *carry += n;
+        return *carry >= run;
+    }
+
+    /* run continuing in from the left edge */
+    unsigned int low_ones = __builtin_ctzll(~m);
+    if (*carry + low_ones >= run) {
+        return true;
+    }
+
+    /* run contained inside this chunk: fold the mask onto itself so a
+    stretch of `run` set lanes leaves at least one bit standing */
+    if (run <= n) {
+        uint64_t t = m;
+        unsigned int k = run;
+        while (k > 1) {
+            unsigned int s = k >> 1;
+            t &= t >> s;
+            k -= s;
+        }
+        if (t != 0) {
+            return true;
+        }
+    }
+
+    /* run hanging off the right edge becomes the next carry */
+    uint64_t x = ~m & full;
+    *carry = n - 1 - (63 - __builtin_clzll(x));
+    return false;
+}
+
+cell board_runs_horizontal(board* b, unsigned int run) {
+    const uint64_t* words = b->u.bits;
+    unsigned int w = b->width;
+
+    for (unsigned int r = 0; r < b->height; r++) {
+        unsigned int bitbase = 2 * r * w;
+        unsigned int carry_b = 0;
+        unsigned int carry_w = 0;
+        for (unsigned int off = 0; off < w; off += 32) {
+            unsigned int n = (w - off < 32) ? w - off : 32;
+            uint64_t x = fetch_bits(words, bitbase + 2 * off, 2 * n);
+            uint64_t lo = x & 0x5555555555555555ULL;
+            uint64_t hi = (x >> 1) & 0x5555555555555555ULL;
+            uint64_t bm = even_bits(lo & ~hi);
+            uint64_t wm = even_bits(hi & ~lo);
+            if (mask_run_hit(bm, n, &carry_b, run)) {
+                return BLACK;
+            }
+            if (mask_run_hit(wm, n, &carry_w, run)) {
+                return WHITE;
             }
-            printf("%c ", piece);
         }
-        printf("\n");
     }
+    return EMPTY;
+}
+
+cell board_runs_vertical(board* b, unsigned int run) {
+    if (b->width % 32 != 0 || run > b->height || run == 0) {
+        return EMPTY;
+    }
+    unsigned int wpr = b->width / 32;
+    const uint64_t* words = b->u.bits;
+
+    /* 32 columns at a time: keep the last `run` row masks per color and
+    AND the window together; any surviving lane is a vertical run */
+    for (unsigned int wc = 0; wc < wpr; wc++) {
+        uint64_t bring[run];
+        uint64_t wring[run];
+        for (unsigned int r = 0; r < b->height; r++) {
+            uint64_t x = words[r * wpr + wc];
+            uint64_t lo = x & 0x5555555555555555ULL;
+            uint64_t hi = (x >> 1) & 0x5555555555555555ULL;
+            bring[r % run] = even_bits(lo & ~hi);
+            wring[r % run] = even_bits(hi & ~lo);
+            if (r + 1 >= run) {
+                uint64_t ab = 0xFFFFFFFFULL;
+                uint64_t aw = 0xFFFFFFFFULL;
+                for (unsigned int k = 0; k < run; k++) {
+                    ab &= bring[k];
+                    aw &= wring[k];
+                }
+                if (ab != 0) {
+                    return BLACK;
+                }
+                if (aw != 0) {
+                    return WHITE;
+                }
+            }
+        }
+    }
+    return EMPTY;
 }
 
 
 void board_set(board* b, pos p, cell c) {
+    STATS_ADD(board_sets, 1);
     if (b->height < p.r || b->width < p.c) {
         printf("Out of bounds error\n");
         exit(1);
     }
+    if (b->refcount != NULL) {
+        cow_materialize(b);
+    }
+    unsigned int idx = p.r * b->width + p.c;
+    if (b->dirty != NULL) {
+        b->dirty[idx / 64] |= 1ULL << (idx % 64);
+    }
     if (b->type == MATRIX) {
-        b->u.matrix[p.r][p.c] = c;
+        b->hash ^= cell_key(idx, b->u.matrix[idx]) ^ cell_key(idx, c);
+        b->u.matrix[idx] = c;
+        return;
     }
-    unsigned int i = (2 * (p.r * b->width + p.c));
-    unsigned int loc = i / 32;
-    unsigned int position = i % 32;
-    b->u.bits[loc] &= ~(0x3 << position);
-    b->u.bits[loc] |= (c << position);
+    unsigned int i = 2 * idx;
+    unsigned int loc = i / 64;
+    unsigned int position = i % 64;
+    b->hash ^= cell_key(idx, (cell)((b->u.bits[loc] >> position) & 0x3));
+    b->hash ^= cell_key(idx, c);
+    b->u.bits[loc] &= ~(0x3ULL << position);
+    b->u.bits[loc] |= ((uint64_t)c << position);
+}
+
+void board_empty_mask(board* b, uint64_t* out) {
+    unsigned int cells = b->width * b->height;
+    unsigned int words = (cells + 63) / 64;
+
+    if (b->type == BITS) {
+        /* two 2-bit source words fill one mask word: compact each
+        word's empty lanes to 32 bits and stitch the halves */
+        unsigned int nsrc = bits_len(b->width, b->height);
+        for (unsigned int o = 0; o < words; o++) {
+            uint64_t x0 = b->u.bits[2 * o];
+            uint64_t lo = even_bits(~(x0 | (x0 >> 1)) & 0x5555555555555555ULL);
+            uint64_t hi = 0;
+            if (2 * o + 1 < nsrc) {
+                uint64_t x1 = b->u.bits[2 * o + 1];
+                hi = even_bits(~(x1 | (x1 >> 1)) & 0x5555555555555555ULL);
+            }
+            out[o] = lo | (hi << 32);
+        }
+    } else {
+        for (unsigned int o = 0; o < words; o++) {
+            out[o] = 0;
+        }
+        for (unsigned int i = 0; i < cells; i++) {
+            if (b->u.matrix[i] == EMPTY) {
+                out[i / 64] |= 1ULL << (i % 64);
+            }
+        }
+    }
+
+    /* lanes past the last cell came from zeroed storage and would read
+    as empty; mask them off */
+    if (cells % 64 != 0) {
+        out[words - 1] &= (1ULL << (cells % 64)) - 1;
+    }
+}
+
+unsigned int board_count_occupied(board* b) {
+    unsigned int cells = b->width * b->height;
+    unsigned int occupied = 0;
+    if (b->type == BITS) {
+        for (unsigned int i = 0; i < bits_len(b->width, b->height); i++) {
+            uint64_t x = b->u.bits[i];
+            occupied += __builtin_popcountll((x | (x >> 1)) &
+                                             0x5555555555555555ULL);
+        }
+    } else {
+        for (unsigned int i = 0; i < cells; i++) {
+            if (b->u.matrix[i] != EMPTY) {
+                occupied++;
+            }
+        }
+    }
+    return occupied;
 }
 
+void board_rehash(board* b) {
+    uint64_t h = 0;
+    unsigned int cells = b->width * b->height;
+    if (b->type == MATRIX) {
+        for (unsigned int i = 0; i < cells; i++) {
+            h ^= cell_key(i, b->u.matrix[i]);
+        }
+    } else {
+        for (unsigned int i = 0; i < cells; i++) {
+            unsigned int bit = 2 * i;
+            h ^= cell_key(i, (cell)((b->u.bits[bit / 64] >> (bit % 64)) & 0x3));
+        }
+    }
+    b->hash = h;
+}
+
+
+
 
+void board_track_diffs(board* b, bool on) {
+    if (on && b->dirty == NULL) {
+        unsigned int words = (b->width * b->height + 63) / 64;
+        STATS_ADD(alloc_bytes, words * sizeof(uint64_t));
+        b->dirty = (uint64_t*)malloc(words * sizeof(uint64_t));
+        if (b->dirty == NULL) {
+            fprintf(stderr, "Diff mask allocation failed\n");
+            exit(1);
+        }
+        for (unsigned int i = 0; i < words; i++) {
+            b->dirty[i] = 0;
+        }
+        b->dirty_all = false;
+    } else if (!on && b->dirty != NULL) {
+        free(b->dirty);
+        b->dirty = NULL;
+        b->dirty_all = false;
+    }
+}
+
+void board_mark_all_dirty(board* b) {
+    if (b->dirty != NULL) {
+        b->dirty_all = true;
+    }
+}
+
+void board_adopt_tracking(board* from, board* to) {
+    if (from == to || from->dirty == NULL) {
+        return;
+    }
+    free(to->dirty);
+    to->dirty = from->dirty;
+    to->dirty_all = from->dirty_all;
+    from->dirty = NULL;
+    from->dirty_all = false;
+}
+
+unsigned int board_diff(board* b, board_delta* out, unsigned int cap) {
+    if (b->dirty == NULL) {
+        return 0;
+    }
+    unsigned int cells = b->width * b->height;
+    unsigned int words = (cells + 63) / 64;
+
+    if (b->dirty_all) {
+        /* the full-frame fallback: saturate the mask and drain it the
+        ordinary way, so a partial drain resumes correctly */
+        for (unsigned int w = 0; w < words; w++) {
+            b->dirty[w] = ~0ULL;
+        }
+        if (cells % 64 != 0) {
+            b->dirty[words - 1] = (1ULL << (cells % 64)) - 1;
+        }
+        b->dirty_all = false;
+    }
+
+    unsigned int n = 0;
+    for (unsigned int w = 0; w < words && n < cap; w++) {
+        while (b->dirty[w] != 0 && n < cap) {
+            unsigned int bit = __builtin_ctzll(b->dirty[w]);
+            b->dirty[w] &= b->dirty[w] - 1;
+            unsigned int idx = w * 64 + bit;
+            out[n].p = make_pos(idx / b->width, idx % b->width);
+            if (b->type == MATRIX) {
+                out[n].c = b->u.matrix[idx];
+            } else {
+                unsigned int i = 2 * idx;
+                out[n].c = (cell)((b->u.bits[i / 64] >> (i % 64)) & 0x3);
+            }
+            n++;
+        }
+    }
+    return n;
+}
@@ -1,7 +1,11 @@
 #ifndef BOARD_H
 #define BOARD_H
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 #include "pos.h"
+#include "stats.h"
 
 
 enum cell {
@@ -14,8 +18,8 @@ typedef enum cell cell;
 
 
 union board_rep {
-    enum cell** matrix;
-    unsigned int* bits;
+    enum cell* matrix;
+    uint64_t* bits;
 };
 
 typedef union board_rep board_rep;
@@ -28,7 +32,23 @@ enum type {
 struct board {
     unsigned int width, height;
     enum type type;
+    uint64_t hash;
     board_rep u;
+    /* NULL for a board that owns its cells outright; otherwise the
+    share count of storage this board holds jointly with its
+    copy-on-write clones */
+    unsigned int* refcount;
+    /* non-NULL when the cell storage lives inside a mapped snapshot
+    file rather than on the heap: the mapping to munmap (and its
+    length) when the last board using it is freed */
+    void* mapping;
+    size_t mapping_len;
+    /* diff tracking for state streaming: when non-NULL, a one-bit-per-
+    cell mask (board_mask_words words) of cells changed since the last
+    board_diff drain; dirty_all short-circuits the mask after
+    whole-board operations like rotation and clearing */
+    uint64_t* dirty;
+    bool dirty_all;
 };
 
 typedef struct board board;
@@ -39,8 +59,8 @@ values, the type of board, and a pointer board representation matrix with
 elements made of cells*/
 board* board_new(unsigned int width, unsigned int height, enum type type);
 
-/* Iterates through each row in the board and 
-frees each allocated row, then the overall matrix*/
+/* Frees the board's cell storage (one flat buffer for either
+representation), then the board itself*/
 void board_free(board* b);
 
 /* Prints out the board representation,
@@ -53,8 +73,166 @@ void board_show(board* b);
 values possible are EMPTY, WHITE, and BLACK, and are type cell. */
 cell board_get(board* b, pos p);
 
-/* Changes the value located at position p on board b; changes 
-value to c, cell, wihtout returning anything*/
+/* Changes the value located at position p on board b; changes
+value to c, cell, wihtout returning anything. On a board sharing its
+cells with copy-on-write clones, the first write quietly materializes
+a private copy first*/
 void board_set(board* b, pos p, cell c);
 
+/* Deep copy: a new board with its own storage holding the same cells,
+copied as one bulk memcpy rather than a cell-by-cell loop*/
+board* board_clone(board* b);
+
+/* Copy-on-write snapshot: a new board sharing b's cell storage under
+a reference count, so forking a position costs a struct allocation
+regardless of board size. Either board materializes a private copy on
+its first board_set; reads never copy. Shared boards must go through
+the checked accessors — the fast setters below assume an exclusive
+owner*/
+board* board_clone_cow(board* b);
+
+/* Unchecked fast-path accessors: identical to board_get/board_set but
+with no bounds check and defined here so engine loops that have already
+validated their ranges (game_outcome scans, rotation kernels) inline
+down to a couple of instructions. Boundary code that handles raw user
+input should keep using the checked functions above; so must anything
+touching a board that might share storage with a copy-on-write clone,
+since only the checked setter materializes*/
+/* Monomorphic accessors: one per representation, for loops that have
+hoisted the type check out of the hot path. The representation never
+changes after board_new, so a loop over one board can pick its variant
+once and run with zero dynamic dispatch in the body, which also keeps
+the compiler free to vectorize*/
+static inline cell board_get_matrix(board* b, pos p) {
+    STATS_ADD(board_gets, 1);
+    return b->u.matrix[p.r * b->width + p.c];
+}
+
+static inline cell board_get_bits(board* b, pos p) {
+    STATS_ADD(board_gets, 1);
+    unsigned int i = 2 * (p.r * b->width + p.c);
+    return (cell)((b->u.bits[i / 64] >> (i % 64)) & 0x3);
+}
+
+static inline void board_set_matrix(board* b, pos p, cell c) {
+    STATS_ADD(board_sets, 1);
+    b->u.matrix[p.r * b->width + p.c] = c;
+}
+
+static inline void board_set_bits(board* b, pos p, cell c) {
+    STATS_ADD(board_sets, 1);
+    unsigned int i = 2 * (p.r * b->width + p.c);
+    b->u.bits[i / 64] &= ~(0x3ULL << (i % 64));
+    b->u.bits[i / 64] |= ((uint64_t)c << (i % 64));
+}
+
+static inline cell board_get_fast(board* b, pos p) {
+    if (b->type == MATRIX) {
+        return board_get_matrix(b, p);
+    }
+    return board_get_bits(b, p);
+}
+
+static inline void board_set_fast(board* b, pos p, cell c) {
+    if (b->type == MATRIX) {
+        board_set_matrix(b, p, c);
+    } else {
+        board_set_bits(b, p, c);
+    }
+}
+
+/* Raw storage accessors for loops that want to walk the representation
+directly: the start of row r of a MATRIX board, and the packed word
+array of a BITS board*/
+static inline cell* board_row_ptr(board* b, unsigned int r) {
+    return b->u.matrix + r * b->width;
+}
+
+static inline uint64_t* board_words(board* b) {
+    return b->u.bits;
+}
+
+/* Number of 64-bit words backing a BITS board of these dimensions*/
+static inline unsigned int board_words_len(unsigned int width,
+                                           unsigned int height) {
+    return (2 * width * height + 63) / 64;
+}
+
+/* Rotates rows row_start up to (but not including) row_end of the
+destination board dst by reading straight out of the packed bits words of
+src, packing 32 cells at a time into each 64-bit destination word instead
+of going through board_get/board_set per cell. Both boards must be BITS
+boards with swapped dimensions; dst must start zeroed*/
+void board_rotate_bits(board* src, board* dst, bool clockwise,
+                       unsigned int row_start, unsigned int row_end);
+
+/* Empties the board: every cell back to EMPTY and the hash back to
+zero, without touching the allocation; one memset of the flat storage*/
+void board_clear(board* b);
+
+/* Recomputes the board's Zobrist hash from its contents; needed after
+bulk operations (rotation kernels, fast setters) that bypass the
+incremental update in board_set*/
+void board_rehash(board* b);
+
+/* Scans every row of a BITS board for `run` consecutive cells of one
+color, 32 cells per word operation instead of one board_get per cell;
+returns the winning color, or EMPTY if no row contains such a run*/
+cell board_runs_horizontal(board* b, unsigned int run);
+
+/* The vertical counterpart: scans columns 32 at a time by ANDing a
+window of `run` consecutive row masks. Only handles widths that are a
+multiple of 32 cells (rows must own whole words); returns EMPTY for
+other widths, so callers need a per-cell fallback there*/
+cell board_runs_vertical(board* b, unsigned int run);
+
+/* Number of non-EMPTY cells on the board: one popcount per word for
+BITS (either bit of a 2-bit cell set means occupied), a linear walk
+for MATRIX*/
+unsigned int board_count_occupied(board* b);
+
+/* Number of 64-bit words in an empty-cell mask for these dimensions
+(one bit per cell, row-major)*/
+static inline unsigned int board_mask_words(unsigned int width,
+                                            unsigned int height) {
+    return (width * height + 63) / 64;
+}
+
+/* Fills out (board_mask_words words) with the empty-cell mask: bit i
+set iff row-major cell i is EMPTY. BITS boards compute it
+word-at-a-time — a cell is empty iff both of its 2 bits are clear, so
+one word test covers 32 cells — MATRIX boards walk the cells*/
+void board_empty_mask(board* b, uint64_t* out);
+
+/* One changed cell in a diff: its position and its current value*/
+struct board_delta {
+    pos p;
+    cell c;
+};
+
+typedef struct board_delta board_delta;
+
+/* Turns diff tracking on or off for b. While tracking is on, board_set
+records each changed cell so board_diff can stream just the cells that
+moved instead of the whole frame; rotation and clearing fall back to
+reporting every cell. Off by default, so untracked boards pay nothing
+beyond one pointer test per set*/
+void board_track_diffs(board* b, bool on);
+
+/* Marks every cell changed, so the next board_diff reports the full
+frame; a no-op when tracking is off. Whole-board operations the diff
+machinery cannot follow cell by cell (rotation) go through this*/
+void board_mark_all_dirty(board* b);
+
+/* Moves diff tracking from one board to another with the same cell
+count: used when the engine swaps a freshly rotated board in for the
+tracked one, so the consumer's tracking survives the swap*/
+void board_adopt_tracking(board* from, board* to);
+
+/* Drains up to cap changed cells into out in row-major order, each
+with its current value, and returns how many were written. Reported
+cells are cleared from the dirty set; anything beyond cap stays dirty
+for the next call. Returns 0 when tracking is off or nothing changed*/
+unsigned int board_diff(board* b, board_delta* out, unsigned int cap);
+
 #endif /* BOARD_H */
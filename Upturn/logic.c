@@ -31,12 +31,66 @@ enum rotation {
 typedef enum rotation rotation;
 
 
+
+enum move_kind {
+    MOVE_PLACE,
+    MOVE_ROTATE,
+    MOVE_UPLIFT
+};
+
+typedef enum move_kind move_kind;
+
+struct move {
+    move_kind kind;
+    pos p;
+    bool clockwise;
+    cell color;
+};
+
+typedef struct move move;
+
+
+/* One undoable step: everything a mutating call changed, recorded so
+undo_move can unwind it in O(1) without copying the board*/
+enum delta_kind {
+    DELTA_PLACE,
+    DELTA_ROTATE,
+    DELTA_UPLIFT
+};
+
+typedef enum delta_kind delta_kind;
+
+struct move_delta {
+    delta_kind kind;
+    pos from, to;
+    cell color;
+    bool clockwise;
+    turn prev_player;
+    rotation prev_last_rotation;
+    outcome prev_cached;
+    bool prev_valid;
+};
+
+typedef struct move_delta move_delta;
+
 struct game {
     unsigned int run;
     board* b;
+    board* spare;
     posqueue *black_queue, *white_queue;
     turn player;
     rotation last_rotation;
+    outcome cached_outcome;
+    bool outcome_valid;
+    unsigned int filled;
+    unsigned int* col_occ;
+    bool col_occ_valid;
+    move_delta* undo_stack;
+    unsigned int undo_len, undo_cap;
+    unsigned int orientation;
+    bool lazy_rotation;
+    uint64_t* empty_mask;
+    bool empty_mask_valid;
 };
 
 typedef struct game game;
@@ -50,26 +104,303 @@ game* new_game(unsigned int run, unsigned int width,
     board* b = board_new(width, height, type);
     game* new = (game*)malloc(sizeof(game));
     new->b = b;
+    new->spare = NULL;
     new->run = run;
     new->black_queue = black;
     new->white_queue = white;
     new->player = BLACKS_TURN;
     new->last_rotation = NO_ROTATION;
+    new->cached_outcome = IN_PROGRESS;
+    new->outcome_valid = false;
+    new->filled = 0;
+    new->col_occ = NULL;
+    new->col_occ_valid = false;
+    new->undo_stack = NULL;
+    new->undo_len = 0;
+    new->undo_cap = 0;
+    new->orientation = 0;
+    new->lazy_rotation = false;
+    new->empty_mask = NULL;
+    new->empty_mask_valid = false;
     return new;
 }
 
+/* Orientation views: in lazy-rotation mode the board is never
+physically rotated — the game keeps an orientation (the number of
+clockwise quarter turns the displayed frame is ahead of the stored
+one), queues and deltas hold stored-frame coordinates, and the
+coordinate mapping is composed on the way in and out. The loops run at
+most three steps, so the mapping is a handful of register moves*/
+
+/* Width and height of the displayed frame*/
+static unsigned int view_width(game* g) {
+    return (g->orientation % 2 == 0) ? g->b->width : g->b->height;
+}
+
+static unsigned int view_height(game* g) {
+    return (g->orientation % 2 == 0) ? g->b->height : g->b->width;
+}
+
+/* Displayed-frame coordinates down to stored-frame coordinates*/
+static pos view_to_phys(game* g, pos p) {
+    unsigned int w = view_width(g);
+    unsigned int h = view_height(g);
+    for (unsigned int i = 0; i < g->orientation; i++) {
+        p = make_pos(w - 1 - p.c, p.r);
+        unsigned int t = w;
+        w = h;
+        h = t;
+    }
+    return p;
+}
+
+/* Stored-frame coordinates up to displayed-frame coordinates*/
+static pos phys_to_view(game* g, pos p) {
+    unsigned int h = g->b->height;
+    for (unsigned int i = 0; i < g->orientation; i++) {
+        p = make_pos(p.c, h - 1 - p.r);
+        h = (h == g->b->height) ? g->b->width : g->b->height;
+    }
+    return p;
+}
+
+void game_set_lazy_rotation(game* g, bool on) {
+    g->lazy_rotation = on;
+}
+
+board* game_snapshot(game* g) {
+    if (g->orientation == 0) {
+        return board_clone(g->b);
+    }
+    /* rendering is the rare human-facing path, so materializing the
+    displayed frame here is the one place the view pays the copy */
+    board* view = board_new(view_width(g), view_height(g), g->b->type);
+    for (unsigned int r = 0; r < view->height; r++) {
+        for (unsigned int c = 0; c < view->width; c++) {
+            pos lp = make_pos(r, c);
+            board_set_fast(view, lp, board_get_fast(g->b, view_to_phys(g, lp)));
+        }
+    }
+    return view;
+}
+
+void game_show(game* g) {
+    if (g->orientation == 0) {
+        board_show(g->b);
+        return;
+    }
+    board* view = game_snapshot(g);
+    board_show(view);
+    board_free(view);
+}
+
+/* Given a cell that was just set to color c, counts how many
+pieces of the same color sit in a row through that cell along the
+direction (dr, dc), looking both ways; returns the length of the run*/
+static unsigned int run_through_cell(game* g, pos p, cell c, int dr, int dc) {
+    unsigned int length = 1;
+    int h = g->b->height;
+    int w = g->b->width;
+
+    int r = (int)p.r + dr;
+    int col = (int)p.c + dc;
+    while (0 <= r && r < h && 0 <= col && col < w &&
+           board_get_fast(g->b, make_pos(r, col)) == c) {
+        length++;
+        r += dr;
+        col += dc;
+    }
+
+    r = (int)p.r - dr;
+    col = (int)p.c - dc;
+    while (0 <= r && r < h && 0 <= col && col < w &&
+           board_get_fast(g->b, make_pos(r, col)) == c) {
+        length++;
+        r -= dr;
+        col -= dc;
+    }
+
+    return length;
+}
+
+/* Folds the cell that was just given color c at position p into the
+cached outcome; only needs to look run cells outward in each of the four
+directions, so the cost per move is O(run) instead of a full board scan*/
+static void outcome_update_cell(game* g, pos p, cell c) {
+    if (!g->outcome_valid || g->cached_outcome != IN_PROGRESS) {
+        return;
+    }
+    if (run_through_cell(g, p, c, 0, 1) >= g->run ||
+        run_through_cell(g, p, c, 1, 0) >= g->run ||
+        run_through_cell(g, p, c, 1, 1) >= g->run ||
+        run_through_cell(g, p, c, 1, -1) >= g->run) {
+        g->cached_outcome = (c == BLACK) ? BLACK_WIN : WHITE_WIN;
+    } else if (g->filled == g->b->width * g->b->height) {
+        g->cached_outcome = DRAW;
+    }
+}
+
+
+/* Pushes one delta onto the game's undo stack, growing it as needed;
+the prev_* fields common to every move kind are filled in here*/
+static move_delta* undo_push(game* g, delta_kind kind) {
+    if (g->undo_len == g->undo_cap) {
+        unsigned int cap = (g->undo_cap == 0) ? 64 : 2 * g->undo_cap;
+        move_delta* grown = (move_delta*)realloc(g->undo_stack,
+                                                 cap * sizeof(move_delta));
+        if (grown == NULL) {
+            return NULL;
+        }
+        g->undo_stack = grown;
+        g->undo_cap = cap;
+    }
+    move_delta* d = &g->undo_stack[g->undo_len++];
+    d->kind = kind;
+    d->prev_player = g->player;
+    d->prev_last_rotation = g->last_rotation;
+    d->prev_cached = g->cached_outcome;
+    d->prev_valid = g->outcome_valid;
+    return d;
+}
+
 
 void game_free(game* g) {
     board_free(g->b);
+    if (g->spare != NULL) {
+        board_free(g->spare);
+    }
     posqueue_free(g->black_queue);
     posqueue_free(g->white_queue);
+    free(g->col_occ);
+    free(g->empty_mask);
+    free(g->undo_stack);
     free(g);
 }
 
+/* The column occupancy index: one bitset per column recording which
+rows hold a piece, stored column-major in col_occ so uplift can find
+the landing row with a couple of word operations instead of walking the
+column cell by cell. Built lazily (a rotation just marks it stale) and
+kept current by place_piece, uplift, and undo_move*/
+
+/* Words per column bitset at the board's current height*/
+static unsigned int occ_words(game* g) {
+    return (g->b->height + 31) / 32;
+}
+
+static void occ_mark(game* g, pos p, bool occupied) {
+    if (!g->col_occ_valid) {
+        return;
+    }
+    unsigned int* word = &g->col_occ[p.c * occ_words(g) + p.r / 32];
+    if (occupied) {
+        *word |= 1u << (p.r % 32);
+    } else {
+        *word &= ~(1u << (p.r % 32));
+    }
+}
+
+/* Rebuilds the index from the board if it has gone stale*/
+static void occ_ensure(game* g) {
+    if (g->col_occ_valid) {
+        return;
+    }
+    unsigned int wpc = occ_words(g);
+    unsigned int words = g->b->width * wpc;
+    g->col_occ = (unsigned int*)realloc(g->col_occ, words * sizeof(unsigned int));
+    for (unsigned int i = 0; i < words; i++) {
+        g->col_occ[i] = 0;
+    }
+    for (unsigned int r = 0; r < g->b->height; r++) {
+        for (unsigned int c = 0; c < g->b->width; c++) {
+            if (board_get_fast(g->b, make_pos(r, c)) != EMPTY) {
+                g->col_occ[c * wpc + r / 32] |= 1u << (r % 32);
+            }
+        }
+    }
+    g->col_occ_valid = true;
+}
+
+/* Highest occupied row strictly above (smaller index than) row r in
+column c, or -1 if that part of the column is empty*/
+static int occ_nearest_above(game* g, unsigned int r, unsigned int c) {
+    unsigned int wpc = occ_words(g);
+    unsigned int* col = g->col_occ + c * wpc;
+    int wi = (int)((r - 1) / 32);
+    unsigned int top = (r - 1) % 32;
+    unsigned int word = col[wi];
+    if (top != 31) {
+        word &= (1u << (top + 1)) - 1;
+    }
+    for (;;) {
+        if (word != 0) {
+            return wi * 32 + 31 - __builtin_clz(word);
+        }
+        if (wi == 0) {
+            return -1;
+        }
+        wi--;
+        word = col[wi];
+    }
+}
+
+/* The empty-cell mask mirrors the board in stored-frame row-major
+bits; these keep it current move by move once game_empty_mask has
+built it*/
+static void empty_mask_mark(game* g, pos p, bool empty) {
+    if (!g->empty_mask_valid) {
+        return;
+    }
+    unsigned int i = p.r * g->b->width + p.c;
+    if (empty) {
+        g->empty_mask[i / 64] |= 1ULL << (i % 64);
+    } else {
+        g->empty_mask[i / 64] &= ~(1ULL << (i % 64));
+    }
+}
+
+const uint64_t* game_empty_mask(game* g) {
+    if (!g->empty_mask_valid) {
+        unsigned int words = board_mask_words(g->b->width, g->b->height);
+        uint64_t* grown = (uint64_t*)realloc(g->empty_mask,
+                                             words * sizeof(uint64_t));
+        if (grown == NULL) {
+            return NULL;
+        }
+        g->empty_mask = grown;
+        board_empty_mask(g->b, g->empty_mask);
+        g->empty_mask_valid = true;
+    }
+    return g->empty_mask;
+}
+
+void game_reset(game* g) {
+    board_clear(g->b);
+    while (g->black_queue->len > 0) {
+        pos_dequeue(g->black_queue);
+    }
+    while (g->white_queue->len > 0) {
+        pos_dequeue(g->white_queue);
+    }
+    g->player = BLACKS_TURN;
+    g->last_rotation = NO_ROTATION;
+    g->cached_outcome = IN_PROGRESS;
+    g->outcome_valid = false;
+    g->filled = 0;
+    g->col_occ_valid = false;
+    g->undo_len = 0;
+    g->orientation = 0;
+    g->empty_mask_valid = false;
+}
+
 bool place_piece(game* g, pos p) {
     cell piece = EMPTY;
-    
+    if (g->lazy_rotation) {
+        p = view_to_phys(g, p);
+    }
+
     if (board_get(g->b, p) == EMPTY) {
+        move_delta* d = undo_push(g, DELTA_PLACE);
         if (g->player == BLACKS_TURN) {
             piece = BLACK;
             pos_enqueue(g->black_queue, p);
@@ -78,6 +409,14 @@ bool place_piece(game* g, pos p) {
             pos_enqueue(g->white_queue, p);
         } 
         board_set(g->b, p, piece);
+        g->filled++;
+        occ_mark(g, p, true);
+        empty_mask_mark(g, p, false);
+        outcome_update_cell(g, p, piece);
+        if (d != NULL) {
+            d->to = p;
+            d->color = piece;
+        }
     } else {
         return false;
     }
@@ -91,113 +430,281 @@ bool place_piece(game* g, pos p) {
     return true;
 }
 
-/* Given an original posqueue pointer, a bool representing clockwise, and the new height and width,
-returns a new posqueue with the entries inside rotated according to the rotated board
+/* Given a posqueue pointer, a bool representing clockwise, and the new
+height and width, rewrites the coordinates of the entries in place to
+match the rotated board, keeping the existing entries and their order
+rather than building a whole new queue
 */
-posqueue* rotate_positions(posqueue* original, bool clockwise, unsigned int neww, unsigned int newh) {
-    posqueue* rotated = posqueue_new();
-
-    pq_entry* node = original->head;
-    while (node) {
-        unsigned int row = node->p.r;
-        unsigned int col = node->p.c;
-        pos rotated_pos;
+void rotate_positions(posqueue* q, bool clockwise, unsigned int neww, unsigned int newh) {
+    for (unsigned int i = 0; i < q->len; i++) {
+        pos* p = pos_at(q, i);
+        unsigned int row = p->r;
+        unsigned int col = p->c;
 
         if (!clockwise) {
-            rotated_pos.r = newh - 1 - col;
-            rotated_pos.c = row;
+            p->r = newh - 1 - col;
+            p->c = row;
         } else {
-            rotated_pos.r = col;
-            rotated_pos.c = neww - 1 - row;
+            p->r = col;
+            p->c = neww - 1 - row;
         }
-
-        pos_enqueue(rotated, rotated_pos);
-        node = node->next;
     }
-
-    return rotated;
 }
 
-/* struct ThreadArgs holds the original and rotated instances
-of the board when using the rotate function, and includes the 'row' value
-indicating which row will be rotated and the direction
-*/
+/* Rotation index maps: for a MATRIX rotation, the source flat index of
+every destination cell depends only on the board dimensions and the
+direction, so it is computed once per (width, height, direction) and
+cached for the life of the process, turning the rotation loop into a
+pure table-driven gather with no per-cell coordinate math. The standard
+deployment sizes (8x8, 16x16, 19x19) are built eagerly the first time
+any map is needed; other sizes are built on first use. Maps are never
+evicted — the table count is bounded by the number of distinct board
+sizes the process ever rotates, a handful in practice*/
 typedef struct {
-    board* original;
-    bool clockwise;
-    unsigned int row;
-    board* rotated;
-} ThreadArgs;
+    unsigned int w, h;
+    bool cw;
+    unsigned int* map;
+} rot_map;
 
+static rot_map* rot_cache = NULL;
+static unsigned int rot_cache_len = 0, rot_cache_cap = 0;
+static pthread_mutex_t rot_lock = PTHREAD_MUTEX_INITIALIZER;
 
-/* rotate_row takes in a pointer to a ThreadArgs instance
-and uses its information to recauculate the row coordinates after rotation; returns
-void
-*/
-void* rotate_row(void* args) {
-    ThreadArgs* threadArgs = (ThreadArgs*)args;
-    board* org = threadArgs->original;
-    bool clockwise = threadArgs->clockwise;
-    unsigned int row = threadArgs->row;
-    board* rotated_board = threadArgs->rotated;
+/* Builds the map for rotating a w x h source: entry d is the source
+index whose cell lands on destination index d*/
+static unsigned int* rot_map_build(unsigned int w, unsigned int h, bool cw) {
+    unsigned int* map = (unsigned int*)malloc(w * h * sizeof(unsigned int));
+    if (map == NULL) {
+        return NULL;
+    }
+    unsigned int newh = w;
+    unsigned int neww = h;
+    for (unsigned int row = 0; row < newh; row++) {
+        for (unsigned int j = 0; j < neww; j++) {
+            unsigned int src;
+            if (cw) {
+                src = (neww - 1 - j) * w + row;
+            } else {
+                src = j * w + (newh - 1 - row);
+            }
+            map[row * neww + j] = src;
+        }
+    }
+    return map;
+}
+
+/* Appends one map to the cache under rot_lock*/
+static unsigned int* rot_cache_add(unsigned int w, unsigned int h, bool cw) {
+    if (rot_cache_len == rot_cache_cap) {
+        unsigned int cap = (rot_cache_cap == 0) ? 8 : 2 * rot_cache_cap;
+        rot_map* grown = (rot_map*)realloc(rot_cache, cap * sizeof(rot_map));
+        if (grown == NULL) {
+            return NULL;
+        }
+        rot_cache = grown;
+        rot_cache_cap = cap;
+    }
+    unsigned int* map = rot_map_build(w, h, cw);
+    if (map == NULL) {
+        return NULL;
+    }
+    rot_map* slot = &rot_cache[rot_cache_len++];
+    slot->w = w;
+    slot->h = h;
+    slot->cw = cw;
+    slot->map = map;
+    return map;
+}
 
+/* Hands back the cached map for this rotation, building it (and, on
+the very first call, the maps for the standard sizes) if needed;
+returns NULL only if allocation fails, in which case the caller falls
+back to per-cell coordinate math*/
+static const unsigned int* rot_map_get(unsigned int w, unsigned int h,
+                                       bool cw) {
+    static bool prewarmed = false;
+    pthread_mutex_lock(&rot_lock);
+    if (!prewarmed) {
+        prewarmed = true;
+        unsigned int std[] = {8, 16, 19};
+        for (unsigned int i = 0; i < 3; i++) {
+            rot_cache_add(std[i], std[i], true);
+            rot_cache_add(std[i], std[i], false);
+        }
+    }
+    unsigned int* map = NULL;
+    for (unsigned int i = 0; i < rot_cache_len; i++) {
+        if (rot_cache[i].w == w && rot_cache[i].h == h &&
+            rot_cache[i].cw == cw) {
+            map = rot_cache[i].map;
+            break;
+        }
+    }
+    if (map == NULL) {
+        map = rot_cache_add(w, h, cw);
+    }
+    pthread_mutex_unlock(&rot_lock);
+    return map;
+}
+
+/* rotate_rows recalculates the coordinates of destination rows r0 up to
+(but not including) r1 after rotation, writing them into the rotated
+board; BITS boards go through the word-level kernel, MATRIX boards
+gather through the precomputed index map (falling back to per-cell
+coordinate math only if the map could not be allocated)
+*/
+static void rotate_rows(board* org, board* rotated, bool clockwise,
+                        unsigned int r0, unsigned int r1) {
     unsigned int newh = org->width;
     unsigned int neww = org->height;
 
-    for (unsigned int j = 0; j < neww; ++j) {
-        pos loc;
-        if (!clockwise) {
-            loc = make_pos(j, newh - 1 - row);
-        } else {
-            loc = make_pos(neww - 1 - j, row);
-        }
-        board_set(rotated_board, make_pos(row, j), board_get(org, loc));
+    if (org->type == BITS) {
+        board_rotate_bits(org, rotated, clockwise, r0, r1);
+        return;
     }
 
+    const unsigned int* map = rot_map_get(org->width, org->height, clockwise);
+    if (map != NULL) {
+        const cell* src = org->u.matrix;
+        cell* dst = rotated->u.matrix;
+        for (unsigned int i = r0 * neww; i < r1 * neww; i++) {
+            dst[i] = src[map[i]];
+        }
+        return;
+    }
 
-    pthread_exit(NULL);
+    for (unsigned int row = r0; row < r1; ++row) {
+        for (unsigned int j = 0; j < neww; ++j) {
+            pos loc;
+            if (!clockwise) {
+                loc = make_pos(j, newh - 1 - row);
+            } else {
+                loc = make_pos(neww - 1 - j, row);
+            }
+            board_set_fast(rotated, make_pos(row, j), board_get_fast(org, loc));
+        }
+    }
 }
 
-/* threads_rotate takes in the board and a direction and returns a new, rotated board 
-using threads with new board placements. Utilizes rotate_row function
-to efficiently rotate rows of the board using threads
+/* The rotation worker pool: a fixed set of threads created once per
+process that rotations are dispatched to, instead of spawning and
+joining one thread per row on every rotate call. Workers pull row
+chunks off a shared cursor under pool_lock and signal pool_done when
+the last chunk of the current job finishes
 */
-board* threads_rotate(board* old, bool clockwise) {
-    unsigned int newh = old->width;
-    unsigned int neww = old->height;
+#define POOL_WORKERS 4
 
-    board* new = board_new(neww, newh, old->type);
-    if (new == NULL) {
-        perror("Board creation failed");
-        return NULL;
-    }
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t pool_job_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pool_wake = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t pool_done = PTHREAD_COND_INITIALIZER;
+static unsigned int pool_nworkers = 0;
+static bool pool_started = false;
+static board* pool_src = NULL;
+static board* pool_dst = NULL;
+static bool pool_cw = false;
+static unsigned int pool_next_row = 0;
+static unsigned int pool_rows = 0;
+static unsigned int pool_chunk = 1;
+static unsigned int pool_pending = 0;
 
-    pthread_t threads[newh];
-    ThreadArgs* threadArgsArray = malloc(newh * sizeof(ThreadArgs));
-    if (threadArgsArray == NULL) {
-        perror("Memory allocation failed");
-        board_free(new);
-        return NULL;
-    }
+/* pool_worker is the body of each pool thread: it sleeps until a
+rotation job is posted, then repeatedly claims the next chunk of
+destination rows and rotates them
+*/
+static void* pool_worker(void* args) {
+    pthread_mutex_lock(&pool_lock);
+    for (;;) {
+        while (pool_next_row >= pool_rows) {
+            pthread_cond_wait(&pool_wake, &pool_lock);
+        }
+        unsigned int r0 = pool_next_row;
+        unsigned int r1 = r0 + pool_chunk;
+        if (r1 > pool_rows) {
+            r1 = pool_rows;
+        }
+        pool_next_row = r1;
+        pthread_mutex_unlock(&pool_lock);
 
-    for (unsigned int i = 0; i < newh; ++i) {
-        threadArgsArray[i].original = old;
-        threadArgsArray[i].clockwise = clockwise;
-        threadArgsArray[i].row = i;
-        threadArgsArray[i].rotated = new;
+        rotate_rows(pool_src, pool_dst, pool_cw, r0, r1);
 
-        if (pthread_create(&threads[i], NULL, rotate_row, (void*)&threadArgsArray[i]) != 0) {
-            perror("Thread creation failed");
-            free(threadArgsArray);
-            board_free(new);
-            return NULL;
+        pthread_mutex_lock(&pool_lock);
+        pool_pending -= r1 - r0;
+        if (pool_pending == 0) {
+            pthread_cond_signal(&pool_done);
         }
     }
-    for (unsigned int i = 0; i < newh; ++i) {
-        pthread_join(threads[i], NULL);
+    return NULL;
+}
+
+/* pool_ensure starts the worker threads the first time a rotation
+needs them; returns how many workers are available (0 means rotate
+on the calling thread instead)
+*/
+static unsigned int pool_ensure(void) {
+    pthread_mutex_lock(&pool_lock);
+    if (!pool_started) {
+        pool_started = true;
+        for (unsigned int i = 0; i < POOL_WORKERS; i++) {
+            pthread_t t;
+            if (pthread_create(&t, NULL, pool_worker, NULL) != 0) {
+                perror("Thread creation failed");
+                break;
+            }
+            pthread_detach(t);
+            pool_nworkers++;
+        }
     }
+    unsigned int n = pool_nworkers;
+    pthread_mutex_unlock(&pool_lock);
+    return n;
+}
 
-    return new;
+/* threads_rotate takes in the board, a destination board with swapped
+dimensions, and a direction, and writes the rotated contents into the
+destination (every cell is overwritten, so the destination does not
+need to be cleared first). Small boards are rotated directly on the
+calling thread; larger ones are posted to the persistent worker pool as
+one job, so a rotation costs a task submission rather than a thread
+spawn per row
+*/
+void threads_rotate(board* old, board* new, bool clockwise) {
+    unsigned int newh = old->width;
+
+#ifdef UPTURN_STATS
+    unsigned long t0 = stats_now_ns();
+#endif
+    if (newh < 2 * POOL_WORKERS || pool_ensure() == 0) {
+        rotate_rows(old, new, clockwise, 0, newh);
+#ifdef UPTURN_STATS
+        stats_rotate_ns(stats_now_ns() - t0);
+#endif
+        return;
+    }
+
+    /* one job at a time: games running on different threads queue up
+    here rather than trampling the shared job state */
+    pthread_mutex_lock(&pool_job_lock);
+    pthread_mutex_lock(&pool_lock);
+    pool_src = old;
+    pool_dst = new;
+    pool_cw = clockwise;
+    pool_rows = newh;
+    pool_next_row = 0;
+    pool_pending = newh;
+    pool_chunk = (newh + 4 * POOL_WORKERS - 1) / (4 * POOL_WORKERS);
+    pthread_cond_broadcast(&pool_wake);
+    while (pool_pending > 0) {
+        pthread_cond_wait(&pool_done, &pool_lock);
+    }
+    pool_rows = 0;
+    pool_src = NULL;
+    pool_dst = NULL;
+    pthread_mutex_unlock(&pool_lock);
+    pthread_mutex_unlock(&pool_job_lock);
+#ifdef UPTURN_STATS
+    stats_rotate_ns(stats_now_ns() - t0);
+#endif
 }
 
 
@@ -208,29 +715,68 @@ bool rotate(game* g, bool clockwise) {
         return false;
     }
 
+    if (g->lazy_rotation) {
+        /* nothing about the cells changes, only the coordinate frame:
+        bump the orientation and leave the board, the queues, the
+        occupancy index, and the cached outcome (runs survive a quarter
+        turn) exactly as they are */
+        move_delta* d = undo_push(g, DELTA_ROTATE);
+        if (d != NULL) {
+            d->clockwise = clockwise;
+        }
+        g->orientation = (g->orientation + (clockwise ? 1 : 3)) % 4;
+        /* the stored cells are untouched, but any streamed frame is now
+        stale in every position */
+        board_mark_all_dirty(g->b);
+        g->last_rotation = clockwise ? CLOCKWISE : COUNTERCLOCKWISE;
+        if (g->player == BLACKS_TURN) {
+            g->player = WHITES_TURN;
+        } else {
+            g->player = BLACKS_TURN;
+        }
+        return true;
+    }
+
     unsigned int newh = g->b->width;
     unsigned int neww = g->b->height;
-    
-    board* transf = threads_rotate(g->b, clockwise);
-    if (transf == NULL) {
-        return false;
+
+    /* reuse the spare buffer from the last rotation when its shape
+    still matches; steady-state rotation then allocates nothing */
+    board* transf = g->spare;
+    if (transf == NULL || transf->width != neww || transf->height != newh ||
+        transf->type != g->b->type) {
+        if (transf != NULL) {
+            board_free(transf);
+        }
+        transf = board_new(neww, newh, g->b->type);
+        if (transf == NULL) {
+            return false;
+        }
     }
+    threads_rotate(g->b, transf, clockwise);
+    board_rehash(transf);
 
-    posqueue* rotated_black = rotate_positions(g->black_queue, clockwise, neww, newh);
-    posqueue* rotated_white = rotate_positions(g->white_queue, clockwise, neww, newh);
+    move_delta* d = undo_push(g, DELTA_ROTATE);
+    if (d != NULL) {
+        d->clockwise = clockwise;
+    }
 
-    posqueue_free(g->black_queue);
-    posqueue_free(g->white_queue);
+    rotate_positions(g->black_queue, clockwise, neww, newh);
+    rotate_positions(g->white_queue, clockwise, neww, newh);
 
+    g->spare = g->b;
     g->b = transf;
-    g->black_queue = rotated_black;
-    g->white_queue = rotated_white;
-   
+    board_adopt_tracking(g->spare, g->b);
+    board_mark_all_dirty(g->b);
+
     if (clockwise) {
         g->last_rotation = CLOCKWISE;
     } else {
         g->last_rotation = COUNTERCLOCKWISE;
     }
+    g->outcome_valid = false;
+    g->col_occ_valid = false;
+    g->empty_mask_valid = false;
 
     if (g->player == BLACKS_TURN) {
         g->player = WHITES_TURN;
@@ -242,52 +788,66 @@ bool rotate(game* g, bool clockwise) {
 }
 
 bool uplift(game* g, cell c) {
-    pos piece;
-    pos check;
+    posqueue* q;
     if (c == BLACK) {
-        if (g->black_queue->head == NULL || g->black_queue->len == 0) {
-            return false;
-        }
-        check.r = g->black_queue->head->p.r - 1;
-        check.c = g->black_queue->head->p.c;
-        if (g->black_queue->head->p.r <= 0 || 
-        board_get(g->b, check) != EMPTY) {
-            printf("At board limit!\n");
-            return false;
-        }
-        piece = pos_dequeue(g->black_queue);
+        q = g->black_queue;
     } else if (c == WHITE) {
-        if (g->white_queue->head == NULL || g->white_queue->len == 0) {
-            return false;
-        }
-        check.r = g->white_queue->head->p.r - 1;
-        check.c = g->white_queue->head->p.c;
-        if (g->white_queue->head->p.r <= 0 ||
-        board_get(g->b, check) != EMPTY) {
-            printf("At board limit!\n");
-            return false;
-        }
-        piece = pos_dequeue(g->white_queue);
+        q = g->white_queue;
+    } else {
+        return false;
     }
-    
-    pos p = {piece.r - 1, piece.c};
-    cell move = board_get(g->b, p);
-    
-    
-    while (p.r >= 0 && move == EMPTY) {
-        if (p.r == 0) {
-            break;
+    if (q->len == 0) {
+        return false;
+    }
+
+    /* the queue holds stored-frame coordinates; the board-limit check
+    and the climb happen in the displayed frame */
+    pos piece = pos_front(q);
+    pos lp = g->lazy_rotation ? phys_to_view(g, piece) : piece;
+    if (lp.r <= 0) {
+        printf("At board limit!\n");
+        return false;
+    }
+    pos check = make_pos(lp.r - 1, lp.c);
+    if (g->lazy_rotation) {
+        check = view_to_phys(g, check);
+    }
+    if (board_get(g->b, check) != EMPTY) {
+        printf("At board limit!\n");
+        return false;
+    }
+    pos_dequeue(q);
+
+    pos p;
+    if (g->orientation == 0) {
+        occ_ensure(g);
+        int above = occ_nearest_above(g, piece.r, piece.c);
+        p = make_pos(above < 0 ? 0 : (unsigned int)above + 1, piece.c);
+    } else {
+        /* the occupancy index is stored-frame and "up" is not a stored
+        column here, so climb the displayed column cell by cell */
+        unsigned int lr = lp.r - 1;
+        while (lr > 0 && board_get_fast(g->b, view_to_phys(g,
+                   make_pos(lr - 1, lp.c))) == EMPTY) {
+            lr--;
         }
-        p.r--;
-        move = board_get(g->b, p);
+        p = view_to_phys(g, make_pos(lr, lp.c));
+    }
+
+    move_delta* d = undo_push(g, DELTA_UPLIFT);
+    if (d != NULL) {
+        d->from = piece;
+        d->to = p;
+        d->color = c;
     }
-    
-    if (p.r >= 0 && move != EMPTY) {
-        p.r++;
-    } 
 
     board_set(g->b, p, c);
     board_set(g->b, piece, EMPTY);
+    occ_mark(g, piece, false);
+    occ_mark(g, p, true);
+    empty_mask_mark(g, piece, true);
+    empty_mask_mark(g, p, false);
+    outcome_update_cell(g, p, c);
     if (g->player == BLACKS_TURN) {
         g->player = WHITES_TURN;
     } else {
@@ -303,78 +863,262 @@ bool uplift(game* g, cell c) {
     return true;
 }
 
-outcome game_outcome(game* g) {
-    
-    for (int i = 0; i < g->b->height; i++) {
-        int w_count = 0;
-        int b_count = 0;
-        for (int j = 0; j < g->b->width; j++) {
-            if (board_get(g->b, make_pos(i, j)) == BLACK) {
-                b_count++;
-                
-            } else if (board_get(g->b, make_pos(i, j)) == WHITE) {
-                w_count++;
-            }
-            if (w_count == g->run) {
-                return WHITE_WIN;
-            } else if (b_count == g->run) {
-                return BLACK_WIN;
-            } 
-        }   
+bool undo_move(game* g) {
+    if (g->undo_len == 0) {
+        return false;
     }
-    
-    for (int j = 0; j < g->b->width; j++) {
-        int w_count = 0;
-        int b_count = 0;
-        for (int i = 0; i < g->b->height; i++) {
-            if (board_get(g->b, make_pos(i, j)) == BLACK) {
-                b_count++;
-                
-            } else if (board_get(g->b, make_pos(i, j)) == WHITE) {
-                w_count++;
+    move_delta* d = &g->undo_stack[--g->undo_len];
+
+    switch (d->kind) {
+        case DELTA_PLACE:
+            board_set(g->b, d->to, EMPTY);
+            occ_mark(g, d->to, false);
+            empty_mask_mark(g, d->to, true);
+            g->filled--;
+            if (d->color == BLACK) {
+                pos_pop_back(g->black_queue);
+            } else {
+                pos_pop_back(g->white_queue);
             }
-            if (w_count == g->run) {
-                return WHITE_WIN;
-            } else if (b_count == g->run) {
-                return BLACK_WIN;
+            break;
+        case DELTA_UPLIFT:
+            board_set(g->b, d->to, EMPTY);
+            board_set(g->b, d->from, d->color);
+            occ_mark(g, d->to, false);
+            occ_mark(g, d->from, true);
+            empty_mask_mark(g, d->to, true);
+            empty_mask_mark(g, d->from, false);
+            if (d->color == BLACK) {
+                pos_pop_back(g->black_queue);
+                pos_enqueue_front(g->black_queue, d->from);
+            } else {
+                pos_pop_back(g->white_queue);
+                pos_enqueue_front(g->white_queue, d->from);
             }
-        }   
-    }    
-    
-    for (int i = 0; i < g->b->height; i++) {
-    for (int j = 0; j < g->b->width; j++) {
-        int b_count = 0;
-        int w_count = 0;
-        for (int k = 0; k < g->run; k++) {
-            if (i + k < g->b->height && j + k < g->b->width) {
-                cell current_cell = board_get(g->b, make_pos(i + k, j + k));
-                if (current_cell == WHITE) {
-                    w_count++;
-                    if (w_count == g->run) {
-                        return WHITE_WIN;
-                    }
-                    b_count = 0;
-                } else if (current_cell == BLACK) {
-                    b_count++;
-                    if (b_count == g->run) {
-                        return BLACK_WIN;
-                    }
-                    w_count = 0;
-                }
+            break;
+        case DELTA_ROTATE: {
+            if (g->lazy_rotation) {
+                g->orientation = (g->orientation + (d->clockwise ? 3 : 1)) % 4;
+                board_mark_all_dirty(g->b);
+                break;
             }
+            /* rotating the other way is an exact inverse, for the
+            board and for the queue coordinates */
+            unsigned int newh = g->b->width;
+            unsigned int neww = g->b->height;
+            board* back = g->spare;
+            threads_rotate(g->b, back, !d->clockwise);
+            board_rehash(back);
+            rotate_positions(g->black_queue, !d->clockwise, neww, newh);
+            rotate_positions(g->white_queue, !d->clockwise, neww, newh);
+            g->spare = g->b;
+            g->b = back;
+            board_adopt_tracking(g->spare, g->b);
+            board_mark_all_dirty(g->b);
+            g->col_occ_valid = false;
+            g->empty_mask_valid = false;
+            break;
         }
     }
+
+    g->player = d->prev_player;
+    g->last_rotation = d->prev_last_rotation;
+    g->cached_outcome = d->prev_cached;
+    g->outcome_valid = d->prev_valid;
+    return true;
 }
 
-    for (int i = 0; i < g->b->height; i++) {
-        for (int j = 0; j < g->b->width; j++) {
-            if (board_get(g->b, make_pos(i, j)) == EMPTY) {
-                return IN_PROGRESS;
+/* game_full_scan streams the whole board once in row-major order,
+maintaining rolling run counters for all four directions at the same
+time: one horizontal counter, and per-column arrays for the vertical
+and both diagonal directions (the down-right counter continues from the
+cell up-left, the down-left counter from the cell up-right, both still
+live in the arrays when a row is processed left to right). Counters are
+signed: positive counts a BLACK run, negative a WHITE run. The empty
+count that refreshes g->filled rides along in the same pass, so every
+cell is read exactly once with sequential access. Used to seed the
+cached outcome and as the verification fallback after a rotation*/
+static outcome game_full_scan(game* g) {
+    unsigned int w = g->b->width;
+    unsigned int h = g->b->height;
+    int run = (int)g->run;
+    unsigned int empty = 0;
+    STATS_ADD(outcome_scans, 1);
+
+    int vert[w];
+    int diag[w];
+    int anti[w];
+    for (unsigned int c = 0; c < w; c++) {
+        vert[c] = 0;
+        diag[c] = 0;
+        anti[c] = 0;
+    }
+
+    /* one counter-update body, stamped out once per representation so
+    the inner loop carries no MATRIX/BITS dispatch */
+#define SCAN_CELL(cur)                                                 \
+            int up_left = prev_dr;                                     \
+            prev_dr = diag[c];                                         \
+            int up_right = (c + 1 < w) ? anti[c + 1] : 0;              \
+                                                                       \
+            if ((cur) == BLACK) {                                      \
+                horiz = (horiz > 0) ? horiz + 1 : 1;                   \
+                vert[c] = (vert[c] > 0) ? vert[c] + 1 : 1;             \
+                diag[c] = (up_left > 0) ? up_left + 1 : 1;             \
+                anti[c] = (up_right > 0) ? up_right + 1 : 1;           \
+                if (horiz >= run || vert[c] >= run ||                  \
+                    diag[c] >= run || anti[c] >= run) {                \
+                    STATS_ADD(outcome_cells, r * w + c + 1);           \
+                    return BLACK_WIN;                                  \
+                }                                                      \
+            } else if ((cur) == WHITE) {                               \
+                horiz = (horiz < 0) ? horiz - 1 : -1;                  \
+                vert[c] = (vert[c] < 0) ? vert[c] - 1 : -1;            \
+                diag[c] = (up_left < 0) ? up_left - 1 : -1;            \
+                anti[c] = (up_right < 0) ? up_right - 1 : -1;          \
+                if (-horiz >= run || -vert[c] >= run ||                \
+                    -diag[c] >= run || -anti[c] >= run) {              \
+                    STATS_ADD(outcome_cells, r * w + c + 1);           \
+                    return WHITE_WIN;                                  \
+                }                                                      \
+            } else {                                                   \
+                empty++;                                               \
+                horiz = 0;                                             \
+                vert[c] = 0;                                           \
+                diag[c] = 0;                                           \
+                anti[c] = 0;                                           \
+            }
+
+    for (unsigned int r = 0; r < h; r++) {
+        int horiz = 0;
+        /* the down-right predecessor of column c is row r-1's counter
+        at column c-1, saved here before that slot is overwritten */
+        int prev_dr = 0;
+        if (g->b->type == MATRIX) {
+            const cell* row = board_row_ptr(g->b, r);
+            for (unsigned int c = 0; c < w; c++) {
+                SCAN_CELL(row[c]);
+            }
+        } else {
+            for (unsigned int c = 0; c < w; c++) {
+                SCAN_CELL(board_get_bits(g->b, make_pos(r, c)));
             }
         }
     }
+#undef SCAN_CELL
+
+    STATS_ADD(outcome_cells, w * h);
+    g->filled = w * h - empty;
+    if (empty > 0) {
+        return IN_PROGRESS;
+    }
     return DRAW;
 }
 
+/* The transposition cache: a small fixed open-addressing table mapping
+a position key (board Zobrist hash mixed with the run length and
+dimensions) to its outcome, so positions reached again through a
+different move order cost a probe instead of a full scan. Collisions
+on the full 64-bit key are vanishingly rare; a zero key is the empty
+slot sentinel. The table is shared by every game thread without a
+lock: the stored key is XORed with the outcome, so a torn read or a
+racing write just fails validation and costs a rescan instead of
+returning a wrong answer*/
+#define TT_SIZE (1u << 16)
+#define TT_PROBES 8
+
+typedef struct {
+    uint64_t key;
+    outcome out;
+} tt_entry;
+
+static tt_entry tt[TT_SIZE];
+
+/* The cache key for g's current position*/
+static uint64_t tt_key(game* g) {
+    uint64_t k = g->b->hash;
+    k ^= (uint64_t)g->run * 0x9E3779B97F4A7C15ULL;
+    k ^= ((uint64_t)g->b->width << 32) | g->b->height;
+    return k;
+}
+
+outcome game_outcome(game* g) {
+    if (g->outcome_valid) {
+        return g->cached_outcome;
+    }
+
+    uint64_t key = tt_key(g);
+    unsigned int slot = (unsigned int)key & (TT_SIZE - 1);
+    if (key != 0) {
+        for (unsigned int i = 0; i < TT_PROBES; i++) {
+            tt_entry* e = &tt[(slot + i) & (TT_SIZE - 1)];
+            if ((e->key ^ (uint64_t)e->out) == key) {
+                g->cached_outcome = e->out;
+                g->outcome_valid = true;
+                return g->cached_outcome;
+            }
+            if (e->key == 0) {
+                break;
+            }
+        }
+    }
+
+    g->cached_outcome = game_full_scan(g);
+    g->outcome_valid = true;
+
+    if (key != 0) {
+        for (unsigned int i = 0; i < TT_PROBES; i++) {
+            tt_entry* e = &tt[(slot + i) & (TT_SIZE - 1)];
+            if (e->key == 0 || (e->key ^ (uint64_t)e->out) == key ||
+                i == TT_PROBES - 1) {
+                e->out = g->cached_outcome;
+                e->key = key ^ (uint64_t)g->cached_outcome;
+                break;
+            }
+        }
+    }
+    return g->cached_outcome;
+}
+
+unsigned long apply_moves(game* g, const move* moves, size_t n) {
+    unsigned long applied = 0;
 
+    /* prime the cache once: the per-cell update in place_piece and
+    uplift only extends a cache that is already valid */
+    game_outcome(g);
 
+    for (size_t i = 0; i < n; i++) {
+        /* the incremental cache already knows if an earlier move ended
+        the game; consulting it is one comparison, not a scan */
+        if (g->outcome_valid && g->cached_outcome != IN_PROGRESS) {
+            break;
+        }
+        const move* m = &moves[i];
+        bool ok;
+        switch (m->kind) {
+            case MOVE_PLACE:
+                ok = place_piece(g, m->p);
+                break;
+            case MOVE_ROTATE:
+                ok = rotate(g, m->clockwise);
+                break;
+            case MOVE_UPLIFT:
+                ok = uplift(g, m->color);
+                break;
+            default:
+                ok = false;
+                break;
+        }
+        if (!ok) {
+            break;
+        }
+        applied++;
+        /* a physical rotation is the one move that invalidates the
+        cache; re-prime so the placements after it stay one-comparison
+        (lazy rotation keeps the cache valid and skips this) */
+        if (!g->outcome_valid) {
+            game_outcome(g);
+        }
+    }
+    return applied;
+}
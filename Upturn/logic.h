@@ -32,12 +32,69 @@ enum rotation {
 typedef enum rotation rotation;
 
 
+/* One move in a batch: a placement at p, a rotation in the given
+direction, or an uplift of the given color — the same three moves the
+individual entry points take, as data*/
+enum move_kind {
+    MOVE_PLACE,
+    MOVE_ROTATE,
+    MOVE_UPLIFT
+};
+
+typedef enum move_kind move_kind;
+
+struct move {
+    move_kind kind;
+    pos p;
+    bool clockwise;
+    cell color;
+};
+
+typedef struct move move;
+
+
+
+/* One undoable step: everything a mutating call changed, recorded so
+undo_move can unwind it in O(1) without copying the board*/
+enum delta_kind {
+    DELTA_PLACE,
+    DELTA_ROTATE,
+    DELTA_UPLIFT
+};
+
+typedef enum delta_kind delta_kind;
+
+struct move_delta {
+    delta_kind kind;
+    pos from, to;
+    cell color;
+    bool clockwise;
+    turn prev_player;
+    rotation prev_last_rotation;
+    outcome prev_cached;
+    bool prev_valid;
+};
+
+typedef struct move_delta move_delta;
+
 struct game {
     unsigned int run;
     board* b;
+    board* spare;
     posqueue *black_queue, *white_queue;
     turn player;
     rotation last_rotation;
+    outcome cached_outcome;
+    bool outcome_valid;
+    unsigned int filled;
+    unsigned int* col_occ;
+    bool col_occ_valid;
+    move_delta* undo_stack;
+    unsigned int undo_len, undo_cap;
+    unsigned int orientation;
+    bool lazy_rotation;
+    uint64_t* empty_mask;
+    bool empty_mask_valid;
 };
 
 typedef struct game game;
@@ -71,6 +128,60 @@ and raises its height position to the top of the board, or directly
 below the first piece it comes into contact with*/
 bool uplift(game* g, cell c);
 
+/* Applies up to n moves from the array as one transaction, returning
+how many were consumed. Outcome evaluation is deferred: between moves
+only the already-maintained incremental cache is consulted (one
+comparison), so a batch never pays a scan per move the way a driver
+calling game_outcome after each move does. The batch stops at the
+first rejected move or the first move that ends the game; a full
+evaluation runs only once up front and again after any physical
+rotation, the one move that invalidates the cache*/
+unsigned long apply_moves(game* g, const move* moves, size_t n);
+
+/* The legal placements of the current position as an empty-cell
+bitmask (bit i set iff row-major stored-frame cell i is EMPTY,
+board_mask_words(b->width, b->height) words long), so a search driver
+expands nodes by iterating set bits instead of probing every cell with
+board_get. Kept incrementally current by place_piece, uplift, and
+undo_move; rebuilt word-at-a-time only after a physical rotation. The
+pointer stays owned by the game and is stale after the next mutating
+call*/
+const uint64_t* game_empty_mask(game* g);
+
+/* Switches the game into (or out of) lazy-rotation mode, where rotate
+is an O(1) orientation update and the board is never physically
+rotated: moves compose the coordinate mapping instead, and the queues
+and undo records keep stored-frame coordinates. Flip it before the
+first rotation (or right after game_reset) — changing mode while the
+orientation is non-zero leaves earlier records in the wrong frame*/
+void game_set_lazy_rotation(game* g, bool on);
+
+/* A freshly allocated copy of the board as the current player sees it
+(the displayed frame when the orientation is non-zero), detached from
+the live game: a renderer can format and free it on its own schedule
+while moves keep landing on the original. Caller frees with
+board_free*/
+board* game_snapshot(game* g);
+
+/* Renders the board as the current player sees it: the stored board
+directly when the orientation is zero, otherwise a materialized copy of
+the displayed frame (rendering is the rare human-facing path, so it is
+the one place the view pays for a copy)*/
+void game_show(game* g);
+
+/* Resets an existing game back to the starting position (empty board,
+empty queues, black to move) without reallocating the board or queue
+storage, so batch drivers can reuse one game instance across many
+games*/
+void game_reset(game* g);
+
+/* Unwinds the most recent successful place_piece, rotate, or uplift,
+restoring the board, the piece queues, whose turn it is, and the
+rotation/outcome bookkeeping; returns false if there is nothing left
+to undo. Lets a search driver explore and retract moves on a single
+game instance instead of deep-copying it per node*/
+bool undo_move(game* g);
+
 /* Determines the current outcome of the game; the game is won 
 if a player has placed run  amount of pieces on the board
 consecutively either horizontally, vertically, or diagonally.
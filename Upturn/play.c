@@ -3,6 +3,9 @@
 #include "logic.h"
 #include "board.h"
 #include <string.h>
+#include <pthread.h>
+#include "record.h"
+#include "stats.h"
 
 
 bool do_turn(game* game, char r, char c) {
@@ -68,9 +71,220 @@ bool do_turn(game* game, char r, char c) {
 }
 
 
+/* A single-slot mailbox between the game loop and the render thread:
+the loop publishes its latest board snapshot without waiting, and the
+render thread formats whatever is newest. Publishing over an
+undelivered frame replaces it, so when rendering falls behind the
+loop drops intermediate frames instead of queueing them and stalling;
+move throughput never waits on terminal or pipe bandwidth*/
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t ready;
+    board* pending;
+    bool stop;
+    unsigned long dropped;
+} renderer;
+
+/* The render thread: takes the newest published frame, formats and
+writes it outside the lock, and goes back to sleep; told to stop, it
+drains the last frame first so the final position always reaches the
+screen*/
+static void* render_worker(void* arg) {
+    renderer* rd = (renderer*)arg;
+    for (;;) {
+        pthread_mutex_lock(&rd->lock);
+        while (rd->pending == NULL && !rd->stop) {
+            pthread_cond_wait(&rd->ready, &rd->lock);
+        }
+        board* frame = rd->pending;
+        rd->pending = NULL;
+        pthread_mutex_unlock(&rd->lock);
+        if (frame == NULL) {
+            return NULL;
+        }
+        board_show(frame);
+        board_free(frame);
+    }
+}
+
+/* Publishes the current position to the render thread and returns
+immediately: the snapshot is one flat copy, and an older frame still
+waiting in the slot is simply replaced*/
+static void render_publish(renderer* rd, game* g) {
+    board* frame = game_snapshot(g);
+    pthread_mutex_lock(&rd->lock);
+    if (rd->pending != NULL) {
+        board_free(rd->pending);
+        rd->dropped++;
+    }
+    rd->pending = frame;
+    pthread_cond_signal(&rd->ready);
+    pthread_mutex_unlock(&rd->lock);
+}
+
+/* Wakes the render thread one last time and waits for it to finish
+the frame it is on (plus any still-pending one)*/
+static void render_stop(renderer* rd, pthread_t thread) {
+    pthread_mutex_lock(&rd->lock);
+    rd->stop = true;
+    pthread_cond_signal(&rd->ready);
+    pthread_mutex_unlock(&rd->lock);
+    pthread_join(thread, NULL);
+}
+
+
+/* Shared state for a batch run: the fixed game parameters, and the
+counters the workers update under one mutex — how many games have been
+claimed so far, and the aggregate results merged in as each worker
+finishes*/
+typedef struct {
+    const char* path;
+    unsigned int run, width, height;
+    enum type constr;
+    bool lazy;
+    unsigned int ngames;
+    pthread_mutex_t lock;
+    unsigned int claimed;
+    unsigned int finished;
+    unsigned int wins[4];
+    unsigned long moves;
+} tournament;
+
+/* One scheduler worker: owns its own game instance and its own handle
+on the move file, and repeatedly claims a game number off the shared
+counter and drives it to completion through do_turn. Moves come from
+the worker's private read position in the file (rewound when it runs
+out, so one recorded stream drives many games); results are tallied
+locally and merged under the lock once at the end. A worker that gets
+through a whole pass over the file without a single move applying
+gives up rather than spinning*/
+static void* batch_worker(void* arg) {
+    tournament* t = (tournament*)arg;
+    FILE* f = fopen(t->path, "r");
+    if (f == NULL) {
+        perror(t->path);
+        return NULL;
+    }
+
+    game* g = new_game(t->run, t->width, t->height, t->constr);
+    game_set_lazy_rotation(g, t->lazy);
+    unsigned int wins[4] = {0, 0, 0, 0};
+    unsigned long moves = 0;
+    unsigned int finished = 0;
+    bool stop = false;
+    char r, c;
+
+    while (!stop) {
+        pthread_mutex_lock(&t->lock);
+        bool claim = t->claimed < t->ngames;
+        if (claim) {
+            t->claimed++;
+        }
+        pthread_mutex_unlock(&t->lock);
+        if (!claim) {
+            break;
+        }
+
+        bool stalled = false;
+        for (;;) {
+            if (fscanf(f, " %c %c", &r, &c) != 2) {
+                if (stalled) {
+                    stop = true;
+                    break;
+                }
+                rewind(f);
+                stalled = true;
+                continue;
+            }
+            if (do_turn(g, r, c)) {
+                stalled = false;
+            }
+            moves++;
+
+            outcome result = game_outcome(g);
+            if (result != IN_PROGRESS) {
+                wins[result]++;
+                finished++;
+                game_reset(g);
+                break;
+            }
+        }
+    }
+
+    pthread_mutex_lock(&t->lock);
+    for (unsigned int i = 0; i < 4; i++) {
+        t->wins[i] += wins[i];
+    }
+    t->moves += moves;
+    t->finished += finished;
+    pthread_mutex_unlock(&t->lock);
+
+    game_free(g);
+    fclose(f);
+    return NULL;
+}
+
+/* Runs ngames games headlessly across nworkers scheduler threads,
+feeding moves from the file at path through do_turn with no rendering
+or prompts: the file holds moves in the interactive format (two
+characters each, whitespace separated). Games are independent, so
+workers just pull game numbers off a shared counter; one line of
+aggregate outcome counts is printed at the end*/
+void run_batch(const char* path, unsigned int ngames, unsigned int run,
+               unsigned int width, unsigned int height, enum type constr,
+               bool lazy, unsigned int nworkers) {
+    if (nworkers == 0) {
+        nworkers = 1;
+    }
+
+    tournament t;
+    t.path = path;
+    t.run = run;
+    t.width = width;
+    t.height = height;
+    t.constr = constr;
+    t.lazy = lazy;
+    t.ngames = ngames;
+    pthread_mutex_init(&t.lock, NULL);
+    t.claimed = 0;
+    t.finished = 0;
+    for (unsigned int i = 0; i < 4; i++) {
+        t.wins[i] = 0;
+    }
+    t.moves = 0;
+
+    pthread_t workers[nworkers];
+    unsigned int started = 0;
+    for (unsigned int i = 0; i < nworkers; i++) {
+        if (pthread_create(&workers[i], NULL, batch_worker, &t) != 0) {
+            perror("Thread creation failed");
+            break;
+        }
+        started++;
+    }
+    if (started == 0) {
+        batch_worker(&t);
+    }
+    for (unsigned int i = 0; i < started; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    pthread_mutex_destroy(&t.lock);
+
+    printf("games,%u,black_wins,%u,white_wins,%u,draws,%u,moves,%lu\n",
+           t.finished, t.wins[BLACK_WIN], t.wins[WHITE_WIN], t.wins[DRAW],
+           t.moves);
+    stats_dump();
+}
+
+
 int main(int argc, char *argv[]) {
     unsigned int run, width, height;
     enum type constr;
+    char* batch_file = NULL;
+    char* replay_file = NULL;
+    unsigned int ngames = 1;
+    unsigned int nworkers = 1;
+    bool lazy = false;
 
     for (unsigned int i=1; i < argc; i++) {
         if (strcmp(argv[i], "-h") == 0) {
@@ -82,6 +296,21 @@ int main(int argc, char *argv[]) {
         if (strcmp(argv[i], "-r") == 0) {
             run = atoi(argv[i+1]);
         }
+        if (strcmp(argv[i], "-batch") == 0) {
+            batch_file = argv[i+1];
+        }
+        if (strcmp(argv[i], "-replay") == 0) {
+            replay_file = argv[i+1];
+        }
+        if (strcmp(argv[i], "-n") == 0) {
+            ngames = atoi(argv[i+1]);
+        }
+        if (strcmp(argv[i], "-j") == 0) {
+            nworkers = atoi(argv[i+1]);
+        }
+        if (strcmp(argv[i], "-lazy") == 0) {
+            lazy = true;
+        }
         if (strcmp(argv[i], "-m") == 0) {
             constr = MATRIX;
         } else if (strcmp(argv[i], "-b") == 0) {
@@ -89,12 +318,50 @@ int main(int argc, char *argv[]) {
     }
     }
 
-    game* new = new_game(run, width, height, constr); 
-    
+    if (replay_file != NULL) {
+        game_record* rec = record_load(replay_file);
+        if (rec == NULL) {
+            fprintf(stderr, "%s: not a record file\n", replay_file);
+            return 1;
+        }
+        game* g = new_game(rec->run, rec->width, rec->height, rec->type);
+        unsigned long applied = record_apply(rec, g);
+        printf("outcome,%d,moves,%lu\n", game_outcome(g), applied);
+        game_free(g);
+        record_free(rec);
+        return 0;
+    }
+
+    if (batch_file != NULL) {
+        run_batch(batch_file, ngames, run, width, height, constr, lazy,
+                  nworkers);
+        return 0;
+    }
+
+    game* new = new_game(run, width, height, constr);
+    game_set_lazy_rotation(new, lazy);
+
+    renderer rd;
+    pthread_mutex_init(&rd.lock, NULL);
+    pthread_cond_init(&rd.ready, NULL);
+    rd.pending = NULL;
+    rd.stop = false;
+    rd.dropped = 0;
+    pthread_t render_thread;
+    bool async = (pthread_create(&render_thread, NULL, render_worker,
+                                 &rd) == 0);
+    if (!async) {
+        perror("Thread creation failed");
+    }
+
     char r, c;
     while (game_outcome(new) == IN_PROGRESS) {
 
-        board_show(new->b);
+        if (async) {
+            render_publish(&rd, new);
+        } else {
+            game_show(new);
+        }
         if (new->player == BLACKS_TURN) {
             printf("Black:  \n");
             scanf("%c %c%*c", &r, &c);
@@ -105,21 +372,26 @@ int main(int argc, char *argv[]) {
 
         }
         do_turn(new, r, c);
-        
 
+
+    }
+    if (async) {
+        render_stop(&rd, render_thread);
     }
+    pthread_mutex_destroy(&rd.lock);
+    pthread_cond_destroy(&rd.ready);
     outcome match = game_outcome(new);
     switch(match){
         case 1:
-            board_show(new->b);
+            game_show(new);
             printf("Black wins!\n");
             break;
         case 2:
-            board_show(new->b);
+            game_show(new);
             printf("White wins!\n");
             break;
         case 3:
-            board_show(new->b);
+            game_show(new);
             printf("Draw! Get better, skill issue.\n");
             break;
         default:
@@ -1,5 +1,6 @@
 #include <stdlib.h>
 #include <stdio.h>
+#include "stats.h"
 
 struct pos {
     unsigned int r, c;
@@ -8,21 +9,44 @@ struct pos {
 typedef struct pos pos;
 
 
-typedef struct pq_entry pq_entry;
-
-struct pq_entry {
-    pos p;
-    pq_entry* next;
-};
-
-
 struct posqueue {
-    pq_entry *head, *tail;
+    pos* items;
+    unsigned int cap;
+    unsigned int start;
     unsigned int len;
 };
 
 typedef struct posqueue posqueue;
 
+/* Smallest ring allocation; capacities stay powers of two so index
+wrapping is a mask instead of a divide*/
+#define POSQUEUE_MIN_CAP 16
+
+/* Makes sure q has room for one more entry, doubling the ring when it
+is full; the old contents are unwrapped into the front of the new
+buffer so start goes back to zero. The buffer is kept across games (it
+never shrinks), so steady-state play does no allocation at all*/
+static void ring_reserve(posqueue* q) {
+    if (q->len < q->cap) {
+        return;
+    }
+    unsigned int cap = (q->cap == 0) ? POSQUEUE_MIN_CAP : 2 * q->cap;
+    STATS_ADD(alloc_bytes, cap * sizeof(pos));
+    pos* items = (pos*)malloc(cap * sizeof(pos));
+    if (items == NULL) {
+        printf("Queue allocation failed!\n");
+        exit(1);
+    }
+    for (unsigned int i = 0; i < q->len; i++) {
+        items[i] = q->items[(q->start + i) & (q->cap - 1)];
+    }
+    free(q->items);
+    q->items = items;
+    q->cap = cap;
+    q->start = 0;
+}
+
+
 pos make_pos(unsigned int r, unsigned int c) {
     struct pos loc = {r, c};
     return loc;
@@ -32,8 +56,9 @@ pos make_pos(unsigned int r, unsigned int c) {
 posqueue* posqueue_new() {
     posqueue* queue = (posqueue*)malloc(sizeof(posqueue));
     if (queue != NULL) {
-        queue->head = NULL;
-        queue->tail = NULL;
+        queue->items = NULL;
+        queue->cap = 0;
+        queue->start = 0;
         queue->len = 0;
     }
     return queue;
@@ -41,52 +66,44 @@ posqueue* posqueue_new() {
 
 
 void pos_enqueue(posqueue* q, pos p) {
-    pq_entry* node = (pq_entry*)malloc(sizeof(pq_entry));
-    if (node == NULL) {
-        return; 
-    }
-
-    node->p = p;
-    node->next = NULL;
-
-    if (q->head == NULL) {
-        q->head = node;
-        q->tail = node;
-        q->len = 1;
-    } else {
-        q->tail->next = node;
-        q->tail = node;
-        q->len += 1;
-    }  
+    ring_reserve(q);
+    q->items[(q->start + q->len) & (q->cap - 1)] = p;
+    q->len += 1;
 }
 
 
 
 pos pos_dequeue(posqueue* q) {
-    if (q == NULL || q->head == NULL) {
+    if (q == NULL || q->len == 0) {
         printf("Empty queue!\n");
         exit(1);
     }
-    pos front = q->head->p;
-    pq_entry* temp = q->head;
-    q->head = q->head->next;
+    pos front = q->items[q->start];
+    q->start = (q->start + 1) & (q->cap - 1);
     q->len -= 1;
-
-    free(temp);
     return front;
 }
 
 
-void posqueue_free(posqueue* q) {
-    pq_entry* temp;
-    while (q->head) {
-        temp = q->head;
-        q->head = q->head->next;
-        free(temp);
-    }
-    free(q);
+void pos_enqueue_front(posqueue* q, pos p) {
+    ring_reserve(q);
+    q->start = (q->start + q->cap - 1) & (q->cap - 1);
+    q->items[q->start] = p;
+    q->len += 1;
 }
 
 
+pos pos_pop_back(posqueue* q) {
+    if (q == NULL || q->len == 0) {
+        printf("Empty queue!\n");
+        exit(1);
+    }
+    q->len -= 1;
+    return q->items[(q->start + q->len) & (q->cap - 1)];
+}
 
 
+void posqueue_free(posqueue* q) {
+    free(q->items);
+    free(q);
+}
@@ -8,16 +8,15 @@ struct pos {
 typedef struct pos pos;
 
 
-typedef struct pq_entry pq_entry;
-
-struct pq_entry {
-    pos p;
-    pq_entry* next;
-};
-
-
+/* The queue is a growable ring buffer: len entries stored contiguously
+in items starting at index start and wrapping at cap, which is always a
+power of two so the wrap is one mask. Front and back are both O(1), and
+iterating by index walks a contiguous array instead of chasing heap
+nodes*/
 struct posqueue {
-    pq_entry *head, *tail;
+    pos* items;
+    unsigned int cap;
+    unsigned int start;
     unsigned int len;
 };
 
@@ -28,20 +27,45 @@ struct with r value r and c value c, returns a pos
 */
 pos make_pos(unsigned int r, unsigned int c);
 
-/*Creates a new posqueue with an empty head
-and tail, returns a pointer to a posqueue*/
+/*Creates a new posqueue with an empty ring buffer,
+returns a pointer to a posqueue*/
 posqueue* posqueue_new();
 
 /* Given a pointer to a posqueue, q, and a pos, p,
-inserts p into q as a pq_entry at the tail, returns nothing*/
+inserts p into q at the tail, returns nothing*/
 void pos_enqueue(posqueue* q, pos p);
 
 /* Given a pointer to a posqueue, takes out the first
-node in the posqueue, returns the pos value, 
-and makes the second node in q the head of the queue*/
+entry in the posqueue, returns the pos value,
+and makes the second entry in q the front of the queue*/
 pos pos_dequeue(posqueue* q);
 
-/* Frees an allocated posqueue and the pq_entries inside, if any*/
+/* Given a pointer to a posqueue, q, and a pos, p, inserts p at the
+front of q instead of the tail; used when unwinding a move that
+dequeued from the front*/
+void pos_enqueue_front(posqueue* q, pos p);
+
+/* Removes the most recently enqueued entry from q and returns its
+pos; exits if the queue is empty*/
+pos pos_pop_back(posqueue* q);
+
+/* Frees an allocated posqueue and its ring buffer*/
 void posqueue_free(posqueue* q);
 
+/* Unchecked accessors for loops that have already checked len: a
+pointer to the i-th entry counting from the front (so coordinate
+rewrites can happen in place), and the front and back entries by
+value*/
+static inline pos* pos_at(posqueue* q, unsigned int i) {
+    return &q->items[(q->start + i) & (q->cap - 1)];
+}
+
+static inline pos pos_front(posqueue* q) {
+    return q->items[q->start];
+}
+
+static inline pos pos_back(posqueue* q) {
+    return q->items[(q->start + q->len - 1) & (q->cap - 1)];
+}
+
 #endif /* POS_H */
@@ -0,0 +1,339 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "logic.h"
+
+
+struct game_record {
+    unsigned int run, width, height;
+    enum type type;
+    unsigned char* moves;
+    unsigned int len, cap;
+};
+
+typedef struct game_record game_record;
+
+/* The binary format: a 4-byte magic, five little-endian 32-bit header
+words (run, width, height, type, move byte count), then the move bytes.
+Placements are two bytes, row then column; the four byte values from
+REC_TAG_BASE up are one-byte rotation and uplift moves, which is why
+coordinates must stay below REC_TAG_BASE*/
+#define REC_MAGIC "UPRC"
+#define REC_TAG_BASE 0xF0
+
+#define REC_ROTATE_CW 0xF0
+#define REC_ROTATE_CCW 0xF1
+#define REC_UPLIFT_BLACK 0xF2
+#define REC_UPLIFT_WHITE 0xF3
+
+
+/* Little-endian 32-bit file words, so records move between machines*/
+static void put32(FILE* f, unsigned int x) {
+    unsigned char b[4] = {x & 0xFF, (x >> 8) & 0xFF,
+                          (x >> 16) & 0xFF, (x >> 24) & 0xFF};
+    fwrite(b, 1, 4, f);
+}
+
+static bool get32(FILE* f, unsigned int* x) {
+    unsigned char b[4];
+    if (fread(b, 1, 4, f) != 4) {
+        return false;
+    }
+    *x = (unsigned int)b[0] | ((unsigned int)b[1] << 8) |
+         ((unsigned int)b[2] << 16) | ((unsigned int)b[3] << 24);
+    return true;
+}
+
+/* Appends one byte to the move stream, doubling the buffer when it
+fills*/
+static void rec_push(game_record* rec, unsigned char byte) {
+    if (rec->len == rec->cap) {
+        unsigned int cap = (rec->cap == 0) ? 64 : 2 * rec->cap;
+        unsigned char* grown = (unsigned char*)realloc(rec->moves, cap);
+        if (grown == NULL) {
+            printf("Record allocation failed!\n");
+            exit(1);
+        }
+        rec->moves = grown;
+        rec->cap = cap;
+    }
+    rec->moves[rec->len++] = byte;
+}
+
+
+game_record* record_new(unsigned int run, unsigned int width,
+                        unsigned int height, enum type type) {
+    if (width >= REC_TAG_BASE || height >= REC_TAG_BASE) {
+        return NULL;
+    }
+    game_record* rec = (game_record*)malloc(sizeof(game_record));
+    if (rec != NULL) {
+        rec->run = run;
+        rec->width = width;
+        rec->height = height;
+        rec->type = type;
+        rec->moves = NULL;
+        rec->len = 0;
+        rec->cap = 0;
+    }
+    return rec;
+}
+
+
+void record_free(game_record* rec) {
+    free(rec->moves);
+    free(rec);
+}
+
+
+void record_place(game_record* rec, pos p) {
+    rec_push(rec, (unsigned char)p.r);
+    rec_push(rec, (unsigned char)p.c);
+}
+
+
+void record_rotate(game_record* rec, bool clockwise) {
+    rec_push(rec, clockwise ? REC_ROTATE_CW : REC_ROTATE_CCW);
+}
+
+
+void record_uplift(game_record* rec, cell c) {
+    rec_push(rec, (c == BLACK) ? REC_UPLIFT_BLACK : REC_UPLIFT_WHITE);
+}
+
+
+bool record_save(const game_record* rec, const char* path) {
+    FILE* f = fopen(path, "wb");
+    if (f == NULL) {
+        return false;
+    }
+    fwrite(REC_MAGIC, 1, 4, f);
+    put32(f, rec->run);
+    put32(f, rec->width);
+    put32(f, rec->height);
+    put32(f, (unsigned int)rec->type);
+    put32(f, rec->len);
+    if (rec->len > 0) {
+        fwrite(rec->moves, 1, rec->len, f);
+    }
+    bool ok = (fclose(f) == 0);
+    return ok;
+}
+
+
+game_record* record_load(const char* path) {
+    FILE* f = fopen(path, "rb");
+    if (f == NULL) {
+        return NULL;
+    }
+
+    char magic[4];
+    unsigned int run, width, height, type, len;
+    if (fread(magic, 1, 4, f) != 4 || memcmp(magic, REC_MAGIC, 4) != 0 ||
+        !get32(f, &run) || !get32(f, &width) || !get32(f, &height) ||
+        !get32(f, &type) || !get32(f, &len) || type > BITS) {
+        fclose(f);
+        return NULL;
+    }
+
+    game_record* rec = record_new(run, width, height, (enum type)type);
+    if (rec == NULL) {
+        fclose(f);
+        return NULL;
+    }
+    if (len > 0) {
+        rec->moves = (unsigned char*)malloc(len);
+        if (rec->moves == NULL || fread(rec->moves, 1, len, f) != len) {
+            record_free(rec);
+            fclose(f);
+            return NULL;
+        }
+        rec->len = len;
+        rec->cap = len;
+    }
+    fclose(f);
+    return rec;
+}
+
+
+unsigned long record_apply(const game_record* rec, game* g) {
+    unsigned long applied = 0;
+    unsigned int i = 0;
+
+    while (i < rec->len) {
+        unsigned char byte = rec->moves[i];
+        bool ok;
+        if (byte < REC_TAG_BASE) {
+            if (i + 1 >= rec->len) {
+                break;
+            }
+            ok = place_piece(g, make_pos(byte, rec->moves[i + 1]));
+            i += 2;
+        } else {
+            switch (byte) {
+                case REC_ROTATE_CW:
+                    ok = rotate(g, true);
+                    break;
+                case REC_ROTATE_CCW:
+                    ok = rotate(g, false);
+                    break;
+                case REC_UPLIFT_BLACK:
+                    ok = uplift(g, BLACK);
+                    break;
+                case REC_UPLIFT_WHITE:
+                    ok = uplift(g, WHITE);
+                    break;
+                default:
+                    ok = false;
+                    break;
+            }
+            i += 1;
+        }
+        if (ok) {
+            applied++;
+        }
+    }
+    return applied;
+}
+
+
+game* record_replay(const game_record* rec) {
+    game* g = new_game(rec->run, rec->width, rec->height, rec->type);
+    record_apply(rec, g);
+    return g;
+}
+
+
+/* The snapshot format: a 4-byte magic, eleven little-endian header
+words (run, width, height, type, player, last_rotation, orientation,
+lazy flag, filled, and the two queue lengths), a payload byte count,
+and 4 bytes of padding so the board payload starts 8-byte aligned for
+direct word access in a mapping. The payload is the board's flat cell
+storage as a raw memory image, followed by the queue contents as
+(row, column) word pairs, front to back*/
+#define SNAP_MAGIC "UPSN"
+#define SNAP_PAYLOAD_OFF 56
+
+/* Bytes of flat cell storage behind a board*/
+static size_t snap_board_bytes(board* b) {
+    if (b->type == MATRIX) {
+        return (size_t)b->width * b->height * sizeof(cell);
+    }
+    return (size_t)board_words_len(b->width, b->height) * sizeof(uint64_t);
+}
+
+/* Little-endian word read out of a mapped header*/
+static unsigned int ld32(const unsigned char* p) {
+    return (unsigned int)p[0] | ((unsigned int)p[1] << 8) |
+           ((unsigned int)p[2] << 16) | ((unsigned int)p[3] << 24);
+}
+
+bool snapshot_save(game* g, const char* path) {
+    FILE* f = fopen(path, "wb");
+    if (f == NULL) {
+        return false;
+    }
+
+    fwrite(SNAP_MAGIC, 1, 4, f);
+    put32(f, g->run);
+    put32(f, g->b->width);
+    put32(f, g->b->height);
+    put32(f, (unsigned int)g->b->type);
+    put32(f, (unsigned int)g->player);
+    put32(f, (unsigned int)g->last_rotation);
+    put32(f, g->orientation);
+    put32(f, g->lazy_rotation ? 1 : 0);
+    put32(f, g->filled);
+    put32(f, g->black_queue->len);
+    put32(f, g->white_queue->len);
+    size_t bytes = snap_board_bytes(g->b);
+    put32(f, (unsigned int)bytes);
+    put32(f, 0);
+    fwrite(g->b->u.matrix, 1, bytes, f);
+
+    for (unsigned int i = 0; i < g->black_queue->len; i++) {
+        pos p = *pos_at(g->black_queue, i);
+        put32(f, p.r);
+        put32(f, p.c);
+    }
+    for (unsigned int i = 0; i < g->white_queue->len; i++) {
+        pos p = *pos_at(g->white_queue, i);
+        put32(f, p.r);
+        put32(f, p.c);
+    }
+    return fclose(f) == 0;
+}
+
+game* snapshot_load(const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < SNAP_PAYLOAD_OFF) {
+        close(fd);
+        return NULL;
+    }
+    size_t len = (size_t)st.st_size;
+    unsigned char* base = (unsigned char*)mmap(NULL, len, PROT_READ | PROT_WRITE,
+                                               MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        return NULL;
+    }
+
+    unsigned int run = ld32(base + 4);
+    unsigned int width = ld32(base + 8);
+    unsigned int height = ld32(base + 12);
+    unsigned int type = ld32(base + 16);
+    unsigned int player = ld32(base + 20);
+    unsigned int last_rot = ld32(base + 24);
+    unsigned int orientation = ld32(base + 28);
+    unsigned int lazy = ld32(base + 32);
+    unsigned int filled = ld32(base + 36);
+    unsigned int black_len = ld32(base + 40);
+    unsigned int white_len = ld32(base + 44);
+    size_t bytes = ld32(base + 48);
+    if (memcmp(base, SNAP_MAGIC, 4) != 0 || type > BITS ||
+        len < SNAP_PAYLOAD_OFF + bytes +
+              8ul * (black_len + white_len)) {
+        munmap(base, len);
+        return NULL;
+    }
+
+    game* g = new_game(run, width, height, (enum type)type);
+    if (bytes != snap_board_bytes(g->b)) {
+        game_free(g);
+        munmap(base, len);
+        return NULL;
+    }
+
+    /* swap the freshly allocated empty storage for the mapped payload:
+    the board reads (and privately writes) file pages from here on */
+    free(g->b->u.matrix);
+    g->b->u.matrix = (cell*)(base + SNAP_PAYLOAD_OFF);
+    g->b->mapping = base;
+    g->b->mapping_len = len;
+    board_rehash(g->b);
+
+    const unsigned char* qp = base + SNAP_PAYLOAD_OFF + bytes;
+    for (unsigned int i = 0; i < black_len; i++) {
+        pos_enqueue(g->black_queue, make_pos(ld32(qp), ld32(qp + 4)));
+        qp += 8;
+    }
+    for (unsigned int i = 0; i < white_len; i++) {
+        pos_enqueue(g->white_queue, make_pos(ld32(qp), ld32(qp + 4)));
+        qp += 8;
+    }
+
+    g->player = (turn)player;
+    g->last_rotation = (rotation)last_rot;
+    g->orientation = orientation;
+    g->lazy_rotation = (lazy != 0);
+    g->filled = filled;
+    return g;
+}
@@ -0,0 +1,71 @@
+#ifndef RECORD_H
+#define RECORD_H
+
+#include <stdbool.h>
+#include "logic.h"
+
+
+/* A recorded game: the new_game parameters it was played with, plus a
+compact move stream. Rotations and uplifts are one byte (a tag in the
+range coordinates never use), placements are two bytes (row, column),
+so a typical game is a few dozen bytes instead of a replayed text log*/
+struct game_record {
+    unsigned int run, width, height;
+    enum type type;
+    unsigned char* moves;
+    unsigned int len, cap;
+};
+
+typedef struct game_record game_record;
+
+/* Creates an empty record for a game with these parameters; returns
+NULL if the board is too big for the move encoding (rows or columns
+that collide with the one-byte move tags, 240 and up)*/
+game_record* record_new(unsigned int run, unsigned int width,
+                        unsigned int height, enum type type);
+
+/* Frees a record and its move stream*/
+void record_free(game_record* rec);
+
+/* Appenders: add one move to the end of the record. Grows the stream
+as needed; exits on allocation failure like the rest of the engine*/
+void record_place(game_record* rec, pos p);
+void record_rotate(game_record* rec, bool clockwise);
+void record_uplift(game_record* rec, cell c);
+
+/* Writes the record to the file at path in the binary format (magic,
+header words, move bytes); returns false if the file cannot be
+written*/
+bool record_save(const game_record* rec, const char* path);
+
+/* Reads a record back from the file at path; returns NULL if the file
+cannot be read or is not a record file*/
+game_record* record_load(const char* path);
+
+/* Applies the record's moves into g, which must have been created with
+matching dimensions, straight through place_piece/rotate/uplift with no
+parsing or rendering; moves the engine rejects are skipped. Returns how
+many moves were applied*/
+unsigned long record_apply(const game_record* rec, game* g);
+
+/* Convenience wrapper: builds a game from the record's header, applies
+every move, and returns the finished game*/
+game* record_replay(const game_record* rec);
+
+/* Writes the whole live game state — header fields, flat board
+storage, both piece queues — to the file at path as one sequential
+dump, so a server checkpoints a game with a handful of writes; returns
+false if the file cannot be written. The board payload is a raw memory
+image, so snapshots are for machines of the same endianness*/
+bool snapshot_save(game* g, const char* path);
+
+/* Reopens a snapshot by mapping the file: the loaded game's board
+points straight into a private mapping of the file, so loading costs a
+few page faults instead of a copy no matter the board size, and pages
+are only touched as the game actually reads them. Writes go to private
+copy-on-write pages and never reach the file; the mapping is released
+when the game is freed. Returns NULL if the file cannot be read or is
+not a snapshot*/
+game* snapshot_load(const char* path);
+
+#endif /* RECORD_H */
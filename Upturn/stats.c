@@ -0,0 +1,38 @@
+#include <stdio.h>
+#include "stats.h"
+
+#ifdef UPTURN_STATS
+
+struct engine_stats engine_stats;
+
+void stats_rotate_ns(unsigned long ns) {
+    unsigned int bucket = 0;
+    while (ns > 1 && bucket < 31) {
+        ns >>= 1;
+        bucket++;
+    }
+    STATS_ADD(rotations, 1);
+    STATS_ADD(rotate_ns_hist[bucket], 1);
+}
+
+void stats_dump(void) {
+    printf("stat,board_gets,%lu\n", engine_stats.board_gets);
+    printf("stat,board_sets,%lu\n", engine_stats.board_sets);
+    printf("stat,alloc_bytes,%lu\n", engine_stats.alloc_bytes);
+    printf("stat,outcome_scans,%lu\n", engine_stats.outcome_scans);
+    printf("stat,outcome_cells,%lu\n", engine_stats.outcome_cells);
+    printf("stat,rotations,%lu\n", engine_stats.rotations);
+    for (unsigned int i = 0; i < 32; i++) {
+        if (engine_stats.rotate_ns_hist[i] != 0) {
+            printf("stat,rotate_ns_le_2^%u,%lu\n", i,
+                   engine_stats.rotate_ns_hist[i]);
+        }
+    }
+}
+
+#else
+
+/* Keeps this translation unit non-empty in the uninstrumented build*/
+typedef int stats_disabled;
+
+#endif /* UPTURN_STATS */
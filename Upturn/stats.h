@@ -0,0 +1,67 @@
+#ifndef STATS_H
+#define STATS_H
+
+/* Optional engine instrumentation, compiled in only when the build
+defines UPTURN_STATS (set STATS=-DUPTURN_STATS on the make command
+line). When enabled, the hot paths bump relaxed atomic counters —
+board accessor call volume, allocator bytes, outcome scan depth, and a
+log2 latency histogram of rotations — and stats_dump prints them, one
+CSV line per counter. When disabled every hook compiles to nothing, so
+the instrumented build is the only one that pays*/
+
+#ifdef UPTURN_STATS
+
+#include <stdint.h>
+#include <time.h>
+
+struct engine_stats {
+    unsigned long board_gets;
+    unsigned long board_sets;
+    unsigned long alloc_bytes;
+    unsigned long outcome_scans;
+    unsigned long outcome_cells;
+    unsigned long rotations;
+    unsigned long rotate_ns_hist[32];
+};
+
+extern struct engine_stats engine_stats;
+
+/* Relaxed so the counters cost one uncontended add on the hot path;
+exact cross-thread ordering of stats is not worth a fence*/
+#define STATS_ADD(field, n) \
+    __atomic_add_fetch(&engine_stats.field, (unsigned long)(n), \
+                       __ATOMIC_RELAXED)
+
+/* Monotonic nanoseconds for the rotation timer*/
+static inline unsigned long stats_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long)ts.tv_sec * 1000000000ul +
+           (unsigned long)ts.tv_nsec;
+}
+
+/* Files one rotation's wall time into the log2 histogram*/
+void stats_rotate_ns(unsigned long ns);
+
+/* Prints every counter, and the non-empty rotation latency buckets,
+to stdout*/
+void stats_dump(void);
+
+#else
+
+#define STATS_ADD(field, n) ((void)0)
+
+static inline unsigned long stats_now_ns(void) {
+    return 0;
+}
+
+static inline void stats_rotate_ns(unsigned long ns) {
+    (void)ns;
+}
+
+static inline void stats_dump(void) {
+}
+
+#endif /* UPTURN_STATS */
+
+#endif /* STATS_H */
@@ -2,6 +2,8 @@
 #include "pos.h"
 #include "board.h"
 #include "logic.h"
+#include "record.h"
+#include "batch.h"
 #include <stdlib.h>
 
 
@@ -31,10 +33,10 @@ Test(pos_enqueue, multiple) {
     pos_enqueue(new, p);
     pos_enqueue(new, p2);
     cr_assert(new->len == 2);
-    cr_assert(new->tail->p.r == 2);
-    cr_assert(new->tail->p.c == 2);
-    cr_assert(new->head->p.r == 1);
-    cr_assert(new->head->p.c == 1);
+    cr_assert(pos_back(new).r == 2);
+    cr_assert(pos_back(new).c == 2);
+    cr_assert(pos_front(new).r == 1);
+    cr_assert(pos_front(new).c == 1);
     posqueue_free(new);
 }
 
@@ -43,8 +45,8 @@ Test(pos_enqueue, single) {
     pos p2 = make_pos(2, 2);
     pos_enqueue(new, p2);
     cr_assert(new->len == 1);
-    cr_assert(new->tail->p.r == 2);
-    cr_assert(new->tail->p.c == 2);
+    cr_assert(pos_back(new).r == 2);
+    cr_assert(pos_back(new).c == 2);
     posqueue_free(new);
 }
 
@@ -58,8 +60,8 @@ Test(pos_dequeue, norm) {
     cr_assert(test.r == 1);
     cr_assert(test.c == 1);
     cr_assert(new->len == 1);
-    cr_assert(new->head->p.r == 5);
-    cr_assert(new->head->p.c == 7);
+    cr_assert(pos_front(new).r == 5);
+    cr_assert(pos_front(new).c == 7);
     posqueue_free(new);
 }
 
@@ -71,7 +73,6 @@ Test(pos_dequeue, one) {
     cr_assert(test.r == 1);
     cr_assert(test.c == 1);
     cr_assert(new->len == 0);
-    cr_assert(new->head == NULL);
     posqueue_free(new);
 }
 
@@ -89,7 +90,7 @@ Test(board_new, small) {
     board* new = board_new(5, 5, MATRIX);
     for (unsigned int i=0; i < 5; i++) {
         for (unsigned int j=0; j < 5; j++) {
-            cr_assert(new->u.matrix[i][j] == EMPTY);
+            cr_assert(new->u.matrix[i * 5 + j] == EMPTY);
         }
     }
     board_free(new);
@@ -99,7 +100,7 @@ Test(board_new, crooked) {
     board* new = board_new(5, 10, MATRIX);
     for (unsigned int i=0; i < 10; i++) {
         for (unsigned int j=0; j < 5; j++) {
-            cr_assert(new->u.matrix[i][j] == EMPTY);
+            cr_assert(new->u.matrix[i * 5 + j] == EMPTY);
         }
     }
     board_free(new);
@@ -109,7 +110,7 @@ Test(board_new, big) {
     board* new = board_new(50, 50, MATRIX);
     for (unsigned int i=0; i < 50; i++) {
         for (unsigned int j=0; j < 50; j++) {
-            cr_assert(new->u.matrix[i][j] == EMPTY);
+            cr_assert(new->u.matrix[i * 50 + j] == EMPTY);
         }
     }
     board_free(new);
@@ -158,6 +159,57 @@ Test(board_get, simple) {
     board_free(b);
 }
 
+Test(board_runs_horizontal, word_boundary) {
+    board* b = board_new(32, 4, BITS);
+    for (unsigned int c = 14; c < 19; c++) {
+        board_set(b, make_pos(1, c), WHITE);
+    }
+    cr_assert(board_runs_horizontal(b, 5) == WHITE);
+    cr_assert(board_runs_horizontal(b, 6) == EMPTY);
+    board_free(b);
+}
+
+Test(board_runs_vertical, aligned) {
+    board* b = board_new(32, 8, BITS);
+    for (unsigned int r = 2; r < 6; r++) {
+        board_set(b, make_pos(r, 7), BLACK);
+    }
+    cr_assert(board_runs_vertical(b, 4) == BLACK);
+    cr_assert(board_runs_vertical(b, 5) == EMPTY);
+    board_free(b);
+}
+
+Test(board_clone, deep) {
+    board* b = board_new(6, 4, BITS);
+    board_set(b, make_pos(2, 3), BLACK);
+
+    board* copy = board_clone(b);
+    cr_assert(board_get(copy, make_pos(2, 3)) == BLACK);
+
+    board_set(copy, make_pos(0, 0), WHITE);
+    cr_assert(board_get(b, make_pos(0, 0)) == EMPTY);
+    board_free(copy);
+    board_free(b);
+}
+
+Test(board_clone_cow, materialize_on_write) {
+    board* b = board_new(8, 8, MATRIX);
+    board_set(b, make_pos(4, 4), BLACK);
+
+    board* snap = board_clone_cow(b);
+    cr_assert(snap->u.matrix == b->u.matrix);
+    cr_assert(board_get(snap, make_pos(4, 4)) == BLACK);
+
+    /* first write forks the storage; the snapshot keeps the old view */
+    board_set(b, make_pos(4, 4), WHITE);
+    cr_assert(board_get(b, make_pos(4, 4)) == WHITE);
+    cr_assert(board_get(snap, make_pos(4, 4)) == BLACK);
+
+    board_free(b);
+    cr_assert(board_get(snap, make_pos(4, 4)) == BLACK);
+    board_free(snap);
+}
+
 Test(board_set, easy) {
     board* b = board_new(3, 3, BITS);
 
@@ -172,6 +224,75 @@ Test(board_set, easy) {
 
 
 
+Test(record_apply, basic) {
+    game_record* rec = record_new(3, 7, 3, BITS);
+    record_place(rec, make_pos(2, 0));
+    record_place(rec, make_pos(2, 6));
+    record_place(rec, make_pos(1, 1));
+    record_place(rec, make_pos(2, 5));
+    record_place(rec, make_pos(0, 2));
+
+    game* g = record_replay(rec);
+    cr_assert(board_get(g->b, make_pos(2, 0)) == BLACK);
+    cr_assert(board_get(g->b, make_pos(2, 6)) == WHITE);
+    cr_assert(game_outcome(g) == BLACK_WIN);
+
+    game_free(g);
+    record_free(rec);
+}
+
+Test(record_save, round_trip) {
+    game_record* rec = record_new(5, 10, 6, MATRIX);
+    record_place(rec, make_pos(5, 1));
+    record_rotate(rec, true);
+    record_uplift(rec, BLACK);
+    cr_assert(record_save(rec, "/tmp/upturn_test.rec"));
+
+    game_record* back = record_load("/tmp/upturn_test.rec");
+    cr_assert(back != NULL);
+    cr_assert(back->run == 5);
+    cr_assert(back->width == 10);
+    cr_assert(back->height == 6);
+    cr_assert(back->type == MATRIX);
+    cr_assert(back->len == rec->len);
+
+    game* g = record_replay(back);
+    cr_assert(g->b->width == 6);
+    cr_assert(g->b->height == 10);
+
+    game_free(g);
+    record_free(back);
+    record_free(rec);
+}
+
+Test(snapshot, save_load) {
+    game* g = new_game(3, 8, 6, BITS);
+    place_piece(g, make_pos(5, 2));
+    place_piece(g, make_pos(5, 3));
+    rotate(g, true);
+    cr_assert(snapshot_save(g, "/tmp/upturn_test.snap"));
+
+    game* back = snapshot_load("/tmp/upturn_test.snap");
+    cr_assert(back != NULL);
+    cr_assert(back->run == 3);
+    cr_assert(back->player == g->player);
+    cr_assert(back->last_rotation == CLOCKWISE);
+    cr_assert(back->filled == 2);
+    cr_assert(back->black_queue->len == 1);
+    for (unsigned int r = 0; r < back->b->height; r++) {
+        for (unsigned int c = 0; c < back->b->width; c++) {
+            pos p = make_pos(r, c);
+            cr_assert(board_get(back->b, p) == board_get(g->b, p));
+        }
+    }
+
+    /* the loaded game is live: writes land in private pages */
+    cr_assert(place_piece(back, make_pos(0, 0)));
+    cr_assert(game_outcome(back) == IN_PROGRESS);
+    game_free(back);
+    game_free(g);
+}
+
 Test(new_game, basic) {
     game* new = new_game(4, 4, 4, BITS);
     cr_assert(new->b->width == 4);
@@ -239,6 +360,128 @@ Test(rotate, ccw) {
     
 }
 
+Test(game_empty_mask, incremental) {
+    game* new = new_game(4, 9, 5, BITS);
+
+    const uint64_t* mask = game_empty_mask(new);
+    cr_assert(__builtin_popcountll(mask[0]) == 45);
+
+    cr_assert(place_piece(new, make_pos(2, 3)));
+    mask = game_empty_mask(new);
+    cr_assert((mask[0] & (1ULL << (2 * 9 + 3))) == 0);
+    cr_assert(__builtin_popcountll(mask[0]) == 44);
+
+    cr_assert(undo_move(new));
+    mask = game_empty_mask(new);
+    cr_assert(__builtin_popcountll(mask[0]) == 45);
+    game_free(new);
+}
+
+Test(board_empty_mask, word_at_a_time) {
+    board* b = board_new(32, 3, BITS);
+    board_set(b, make_pos(0, 31), BLACK);
+    board_set(b, make_pos(1, 0), WHITE);
+
+    uint64_t mask[2];
+    board_empty_mask(b, mask);
+    cr_assert((mask[0] & (1ULL << 31)) == 0);
+    cr_assert((mask[0] & (1ULL << 32)) == 0);
+    cr_assert(__builtin_popcountll(mask[0]) + __builtin_popcountll(mask[1])
+              == 94);
+    board_free(b);
+}
+
+Test(board_diff, changed_cells_only) {
+    board* b = board_new(6, 4, BITS);
+    board_track_diffs(b, true);
+
+    board_set(b, make_pos(1, 2), BLACK);
+    board_set(b, make_pos(0, 0), WHITE);
+
+    board_delta out[8];
+    unsigned int n = board_diff(b, out, 8);
+    cr_assert(n == 2);
+    cr_assert(out[0].p.r == 0 && out[0].p.c == 0 && out[0].c == WHITE);
+    cr_assert(out[1].p.r == 1 && out[1].p.c == 2 && out[1].c == BLACK);
+
+    cr_assert(board_diff(b, out, 8) == 0);
+    board_set(b, make_pos(1, 2), EMPTY);
+    n = board_diff(b, out, 8);
+    cr_assert(n == 1);
+    cr_assert(out[0].c == EMPTY);
+    board_free(b);
+}
+
+Test(board_diff, full_frame_after_rotate) {
+    game* new = new_game(3, 4, 4, BITS);
+    board_track_diffs(new->b, true);
+
+    board_delta out[16];
+    cr_assert(place_piece(new, make_pos(2, 1)));
+    cr_assert(board_diff(new->b, out, 16) == 1);
+
+    /* tracking rides the spare-board swap, and the rotation reports
+    every cell; a partial drain resumes where it stopped */
+    cr_assert(rotate(new, true));
+    cr_assert(board_diff(new->b, out, 10) == 10);
+    cr_assert(board_diff(new->b, out, 10) == 6);
+    cr_assert(board_diff(new->b, out, 10) == 0);
+    game_free(new);
+}
+
+Test(lazy_rotation, place_through_view) {
+    game* new = new_game(5, 10, 6, BITS);
+    game_set_lazy_rotation(new, true);
+
+    cr_assert(rotate(new, true));
+    /* board storage untouched, only the frame moved */
+    cr_assert(new->b->width == 10);
+    cr_assert(new->orientation == 1);
+
+    /* displayed (0,0) is stored (5,0) after one clockwise turn */
+    cr_assert(place_piece(new, make_pos(0, 0)));
+    cr_assert(board_get(new->b, make_pos(5, 0)) == WHITE);
+
+    cr_assert(undo_move(new));
+    cr_assert(undo_move(new));
+    cr_assert(new->orientation == 0);
+    cr_assert(board_get(new->b, make_pos(5, 0)) == EMPTY);
+    game_free(new);
+}
+
+Test(game_snapshot, detached_view) {
+    game* new = new_game(3, 5, 4, BITS);
+    game_set_lazy_rotation(new, true);
+
+    cr_assert(place_piece(new, make_pos(3, 0)));
+    cr_assert(rotate(new, true));
+
+    /* the snapshot holds the displayed frame, and later moves on the
+    live game do not reach it */
+    board* snap = game_snapshot(new);
+    cr_assert(snap->width == 4 && snap->height == 5);
+    cr_assert(board_get(snap, make_pos(0, 0)) == BLACK);
+
+    cr_assert(place_piece(new, make_pos(0, 1)));
+    cr_assert(board_get(snap, make_pos(0, 1)) == EMPTY);
+    board_free(snap);
+    game_free(new);
+}
+
+Test(lazy_rotation, outcome_survives_turn) {
+    game* new = new_game(3, 5, 4, BITS);
+    game_set_lazy_rotation(new, true);
+
+    board_set(new->b, make_pos(2, 1), BLACK);
+    board_set(new->b, make_pos(2, 2), BLACK);
+    board_set(new->b, make_pos(2, 3), BLACK);
+    cr_assert(game_outcome(new) == BLACK_WIN);
+
+    cr_assert(rotate(new, false));
+    cr_assert(game_outcome(new) == BLACK_WIN);
+    game_free(new);
+}
+
 Test(uplift, small) {
     game* new = new_game(5, 10, 6, BITS);
     pos p1 = make_pos(1, 1);
@@ -288,6 +531,40 @@ Test(uplift, piece) {
     game_free(new);
 }
 
+Test(undo_move, place) {
+    game* new = new_game(3, 4, 4, BITS);
+    cr_assert(place_piece(new, make_pos(2, 2)));
+    cr_assert(undo_move(new));
+    cr_assert(board_get(new->b, make_pos(2, 2)) == EMPTY);
+    cr_assert(new->player == BLACKS_TURN);
+    cr_assert(new->black_queue->len == 0);
+    cr_assert(!undo_move(new));
+    game_free(new);
+}
+
+Test(undo_move, rotate) {
+    game* new = new_game(3, 4, 4, BITS);
+    cr_assert(place_piece(new, make_pos(1, 2)));
+    cr_assert(rotate(new, true));
+    cr_assert(undo_move(new));
+    cr_assert(board_get(new->b, make_pos(1, 2)) == BLACK);
+    cr_assert(pos_front(new->black_queue).r == 1);
+    cr_assert(pos_front(new->black_queue).c == 2);
+    cr_assert(new->last_rotation == NO_ROTATION);
+    game_free(new);
+}
+
+Test(undo_move, uplift) {
+    game* new = new_game(3, 4, 4, BITS);
+    cr_assert(place_piece(new, make_pos(3, 1)));
+    cr_assert(uplift(new, BLACK));
+    cr_assert(undo_move(new));
+    cr_assert(board_get(new->b, make_pos(0, 1)) == EMPTY);
+    cr_assert(board_get(new->b, make_pos(3, 1)) == BLACK);
+    cr_assert(pos_front(new->black_queue).r == 3);
+    game_free(new);
+}
+
 Test(game_outcome, w_win) {
     game* new = new_game(5, 10, 10, BITS);
     for (unsigned int i=2; i < 7; i++) {
@@ -321,6 +598,50 @@ Test(game_outcome, diagonal_win) {
     game_free(new);
 }
 
+Test(game_outcome, anti_diagonal_win) {
+    game* new = new_game(3, 7, 3, BITS);
+
+    for (unsigned int i = 0; i < 3; i++) {
+        board_set(new->b, make_pos(i, 4 - i), WHITE);
+    }
+
+    outcome result = game_outcome(new);
+    cr_assert(result == WHITE_WIN);
+    game_free(new);
+}
+
+Test(apply_moves, stops_on_win) {
+    game* new = new_game(3, 7, 3, BITS);
+    move batch[7] = {
+        {MOVE_PLACE, {0, 0}, false, EMPTY},
+        {MOVE_PLACE, {2, 0}, false, EMPTY},
+        {MOVE_PLACE, {0, 1}, false, EMPTY},
+        {MOVE_PLACE, {2, 1}, false, EMPTY},
+        {MOVE_PLACE, {0, 2}, false, EMPTY},
+        {MOVE_PLACE, {2, 2}, false, EMPTY},
+        {MOVE_PLACE, {1, 0}, false, EMPTY}
+    };
+
+    unsigned long applied = apply_moves(new, batch, 7);
+    cr_assert(applied == 5);
+    cr_assert(game_outcome(new) == BLACK_WIN);
+    game_free(new);
+}
+
+Test(apply_moves, stops_on_rejection) {
+    game* new = new_game(3, 7, 3, BITS);
+    move batch[3] = {
+        {MOVE_PLACE, {0, 0}, false, EMPTY},
+        {MOVE_PLACE, {0, 0}, false, EMPTY},
+        {MOVE_PLACE, {0, 1}, false, EMPTY}
+    };
+
+    unsigned long applied = apply_moves(new, batch, 3);
+    cr_assert(applied == 1);
+    cr_assert(board_get(new->b, make_pos(0, 0)) == BLACK);
+    game_free(new);
+}
+
 Test(game_outcome, draw) {
     game* new = new_game(3, 3, 3, BITS);
 
@@ -352,3 +673,66 @@ Test(game_outcome, in_progress) {
 }
 
 
+
+Test(batch_place, independent_games) {
+    batch* mb = batch_new(2, 3, 5, 4);
+
+    /* one move per game per round; the games share nothing but shape */
+    pos r1[2] = {{0, 0}, {1, 1}};
+    pos r2[2] = {{1, 0}, {2, 2}};
+    pos r3[2] = {{0, 1}, {1, 1}};   /* game 1 repeats an occupied cell */
+    pos r4[2] = {{1, 1}, {3, 3}};
+    pos r5[2] = {{0, 2}, {0, 4}};
+
+    cr_assert(batch_place(mb, r1) == 2);
+    cr_assert(batch_place(mb, r2) == 2);
+    cr_assert(batch_place(mb, r3) == 1);
+    cr_assert(batch_place(mb, r4) == 2);
+    cr_assert(batch_place(mb, r5) == 2);
+
+    cr_assert(mb->out[0] == BLACK_WIN);
+    cr_assert(mb->out[1] == IN_PROGRESS);
+    cr_assert(mb->live == 1);
+    cr_assert(batch_get(mb, 0, make_pos(0, 2)) == BLACK);
+    cr_assert(batch_get(mb, 1, make_pos(3, 3)) == BLACK);
+
+    /* a decided game ignores further moves */
+    pos r6[2] = {{3, 4}, {2, 0}};
+    cr_assert(batch_place(mb, r6) == 1);
+    cr_assert(batch_get(mb, 0, make_pos(3, 4)) == EMPTY);
+    batch_free(mb);
+}
+
+Test(batch_place, draw_when_full) {
+    batch* mb = batch_new(1, 3, 2, 2);
+
+    pos m[1];
+    m[0] = make_pos(0, 0);
+    cr_assert(batch_place(mb, m) == 1);
+    m[0] = make_pos(0, 1);
+    cr_assert(batch_place(mb, m) == 1);
+    m[0] = make_pos(1, 0);
+    cr_assert(batch_place(mb, m) == 1);
+    m[0] = make_pos(1, 1);
+    cr_assert(batch_place(mb, m) == 1);
+
+    cr_assert(mb->out[0] == DRAW);
+    cr_assert(mb->live == 0);
+    batch_free(mb);
+}
+
+Test(batch_empty_mask, soa_lockstep) {
+    batch* mb = batch_new(2, 3, 9, 5);
+
+    pos r1[2] = {{2, 3}, {4, 8}};
+    cr_assert(batch_place(mb, r1) == 2);
+
+    /* mask word o of game g lands at out[o * n + g] */
+    uint64_t mask[2];
+    batch_empty_mask(mb, mask);
+    cr_assert(__builtin_popcountll(mask[0]) == 44);
+    cr_assert(__builtin_popcountll(mask[1]) == 44);
+    cr_assert((mask[0] & (1ULL << (2 * 9 + 3))) == 0);
+    cr_assert((mask[1] & (1ULL << (4 * 9 + 8))) == 0);
+    batch_free(mb);
+}